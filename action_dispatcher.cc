@@ -4,20 +4,34 @@
 
 #include "config_io.h"
 #include "interaction.h"
+#include "latency_tracker.h"
 
 void crash(const char* s);
 std::vector<Detector*> g_HACK_all_detectors;
 
-ActionDispatcher::ActionDispatcher(BlockingQueue<Action>* action_queue)
+ActionDispatcher::ActionDispatcher(ActionRing* action_queue)
   : action_queue_(action_queue) {}
 
 extern bool g_show_debug_info;
 bool ActionDispatcher::dispatchNextAction()
 {
-  std::optional<Action> action = action_queue_->deque();
-  if (!action.has_value())
+  std::optional<TimedAction> timed = action_queue_->deque();
+  if (!timed.has_value())
     return false;
-  switch (action.value())
+  const int64_t dequeue_nanos = latencyNowNanos();
+  if (timed->decision_nanos != 0)
+  {
+    clickLatency()->decision_to_dequeue.record(dequeue_nanos -
+                                               timed->decision_nanos);
+  }
+  if (action_queue_->dropped() > dropped_reported_)
+  {
+    dropped_reported_ = action_queue_->dropped();
+    PRINTERR(stderr, "action ring overflowed: %llu actions dropped so far\n",
+             (unsigned long long)dropped_reported_);
+  }
+  const Action action = timed->action;
+  switch (action)
   {
   case Action::LeftDown:
     if (g_show_debug_info)
@@ -40,10 +54,14 @@ bool ActionDispatcher::dispatchNextAction()
     rightUp();
     break;
   case Action::ScrollUp:
-    PRINTF("ScrollUp not implemented\n");//scrollUp();
+    if (g_show_debug_info)
+      PRINTF("ScrollUp\n");
+    scrollUp();
     break;
   case Action::ScrollDown:
-    PRINTF("ScrollDown not implemented\n");//scrollDown();
+    if (g_show_debug_info)
+      PRINTF("ScrollDown\n");
+    scrollDown();
     break;
   case Action::CopyPaste:
     if (g_show_debug_info)
@@ -65,6 +83,11 @@ bool ActionDispatcher::dispatchNextAction()
   default:
     PRINTF("[unknown action] not implemented\n");
   }
+  if (action == Action::LeftDown || action == Action::LeftUp ||
+      action == Action::RightDown || action == Action::RightUp)
+  {
+    clickLatency()->dequeue_to_input.record(latencyNowNanos() - dequeue_nanos);
+  }
   return true;
 }
 
@@ -218,6 +241,12 @@ void initLinuxUinput()
   ioctl(g_linux_uinput_fd, UI_SET_EVBIT, EV_SYN);
   ioctl(g_linux_uinput_fd, UI_SET_KEYBIT, BTN_LEFT);
   ioctl(g_linux_uinput_fd, UI_SET_KEYBIT, BTN_RIGHT);
+  // (REL_X/Y are never sent, but without them udev/libinput don't consider
+  // this device a mouse, and may ignore its wheel).
+  ioctl(g_linux_uinput_fd, UI_SET_EVBIT, EV_REL);
+  ioctl(g_linux_uinput_fd, UI_SET_RELBIT, REL_X);
+  ioctl(g_linux_uinput_fd, UI_SET_RELBIT, REL_Y);
+  ioctl(g_linux_uinput_fd, UI_SET_RELBIT, REL_WHEEL);
 
   ioctl(g_linux_uinput_fd, UI_SET_KEYBIT, KEY_LEFTSHIFT);
   ioctl(g_linux_uinput_fd, UI_SET_KEYBIT, KEY_UP);
@@ -243,12 +272,12 @@ void initLinuxUinput()
   ioctl(g_linux_uinput_fd, UI_DEV_CREATE);
 }
 
-void uinputWrite(int code, int val)
+void uinputWrite(int code, int val, int type = EV_KEY)
 {
   assert(g_linux_uinput_fd != -1);
 
   struct input_event ie;
-  ie.type = EV_KEY;
+  ie.type = type;
   ie.code = code;
   ie.value = val;
   ie.time.tv_sec = 0;
@@ -321,6 +350,14 @@ void ActionDispatcher::rightUp()
 {
   uinputWrite(BTN_RIGHT, 0);
 }
+void ActionDispatcher::scrollUp()
+{
+  uinputWrite(REL_WHEEL, 1, EV_REL);
+}
+void ActionDispatcher::scrollDown()
+{
+  uinputWrite(REL_WHEEL, -1, EV_REL);
+}
 void ActionDispatcher::copyPaste()
 {
   if (currently_pasting_)
@@ -352,12 +389,12 @@ void readFIFO()
   // TODO implement some sort of global hotkey reading to support voice-to-LLM on windows
 }
 
-void mouseButtonEvent(DWORD mouse_event_flag)
+void mouseButtonEvent(DWORD mouse_event_flag, DWORD mouse_data = 0)
 {
   INPUT input;
   input.type = INPUT_MOUSE;
   input.mi.dx = input.mi.dy = 0;
-  input.mi.mouseData = 0;
+  input.mi.mouseData = mouse_data;
   input.mi.dwFlags = mouse_event_flag;
   input.mi.time = 0;
   input.mi.dwExtraInfo = 0;
@@ -380,6 +417,14 @@ void ActionDispatcher::rightUp()
 {
   mouseButtonEvent(MOUSEEVENTF_RIGHTUP);
 }
+void ActionDispatcher::scrollUp()
+{
+  mouseButtonEvent(MOUSEEVENTF_WHEEL, WHEEL_DELTA);
+}
+void ActionDispatcher::scrollDown()
+{
+  mouseButtonEvent(MOUSEEVENTF_WHEEL, (DWORD)-WHEEL_DELTA);
+}
 void ActionDispatcher::copyPaste()
 { // TODO
 }
@@ -488,6 +533,21 @@ void ActionDispatcher::rightUp()
   CGEventPost(kCGSessionEventTap, event);
   CFRelease(event);
 }
+void scrollWheelEvent(int32_t lines)
+{
+  CGEventRef event = CGEventCreateScrollWheelEvent(NULL, kCGScrollEventUnitLine,
+                                                   1, lines);
+  CGEventPost(kCGSessionEventTap, event);
+  CFRelease(event);
+}
+void ActionDispatcher::scrollUp()
+{
+  scrollWheelEvent(1);
+}
+void ActionDispatcher::scrollDown()
+{
+  scrollWheelEvent(-1);
+}
 
 // TODO test that this actually works on OSX
 #include <sys/types.h>
@@ -1,8 +1,8 @@
 #ifndef CLICKITONGUE_ACTION_EFFECTOR_H_
 #define CLICKITONGUE_ACTION_EFFECTOR_H_
 
+#include "action_ring.h"
 #include "audio_recording.h"
-#include "blocking_queue.h"
 #include "constants.h"
 #include "detector.h"
 
@@ -14,7 +14,7 @@ void initLinuxUinput();
 class ActionDispatcher
 {
 public:
-  ActionDispatcher(BlockingQueue<Action>* action_queue);
+  ActionDispatcher(ActionRing* action_queue);
 
   // returns false if we have shut down
   bool dispatchNextAction();
@@ -26,13 +26,14 @@ private:
   void leftUp();
   void rightDown();
   void rightUp();
-//   void scrollUp();
-//   void scrollDown();
+  void scrollUp();
+  void scrollDown();
   void copyPaste();
   void justCopy();
   void justPaste();
 
-  BlockingQueue<Action>* const action_queue_;
+  ActionRing* const action_queue_;
+  uint64_t dropped_reported_ = 0;
   bool currently_pasting_ = false;
 };
 
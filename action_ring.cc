@@ -0,0 +1,30 @@
+#include "action_ring.h"
+
+void ActionRing::enqueue(TimedAction const& action)
+{
+  if (!ring_.tryPush(action))
+  {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  wakeup_.wake();
+}
+
+std::optional<TimedAction> ActionRing::deque()
+{
+  TimedAction ret;
+  while (true)
+  {
+    if (ring_.tryPop(&ret))
+      return ret;
+    if (shut_down_.load(std::memory_order_acquire))
+      return std::nullopt;
+    wakeup_.wait();
+  }
+}
+
+void ActionRing::shutdown()
+{
+  shut_down_.store(true, std::memory_order_release);
+  wakeup_.wake();
+}
@@ -0,0 +1,47 @@
+#ifndef CLICKITONGUE_ACTION_RING_H_
+#define CLICKITONGUE_ACTION_RING_H_
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+
+#include "latency_tracker.h"
+#include "spsc_ring.h"
+#include "wakeup.h"
+
+// Carries actions from the detectors, which run in the PortAudio callback, to
+// the ActionDispatcher thread. enqueue() is wait-free: no lock for the audio
+// thread to get stuck behind (or to invert priority on), and no allocation.
+// The dispatcher sleeps in deque() until woken (see Wakeup).
+//
+// Exactly one thread may enqueue() (all detectors run on the same thread),
+// and exactly one may deque().
+class ActionRing
+{
+public:
+  ActionRing() = default;
+  ActionRing(ActionRing const&) = delete;
+  ActionRing& operator=(ActionRing const&) = delete;
+
+  // If the dispatcher has somehow fallen kCapacity actions behind, drops the
+  // action rather than waiting, and counts it in dropped().
+  void enqueue(TimedAction const& action);
+
+  // Blocks until an action is available. Returns nullopt once the ring has
+  // been shut down and drained, meaning the consumer should go away.
+  std::optional<TimedAction> deque();
+
+  // Can be called from any thread.
+  void shutdown();
+
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+  static constexpr int kCapacity = 64;
+  SpscRing<TimedAction, kCapacity> ring_;
+  std::atomic<bool> shut_down_{false};
+  std::atomic<uint64_t> dropped_{0};
+  Wakeup wakeup_;
+};
+
+#endif // CLICKITONGUE_ACTION_RING_H_
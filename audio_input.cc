@@ -1,10 +1,13 @@
 #include "audio_input.h"
 
 #include "config_io.h"
+#include "dsp_kernels.h"
 #include "interaction.h"
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 
 #ifdef CLICKITONGUE_LINUX
 #include "pa_linux_alsa.h"
@@ -30,7 +33,6 @@ int recordCallback(const void* input_buf, void* output_buf,
 {
   RecordingState* data_ptr = static_cast<RecordingState*>(user_data);
   const Sample* cur_in = static_cast<const Sample*>(input_buf);
-  std::vector<Sample>* recorded_samples = &data_ptr->samples;
   int done_or_continue = paContinue;
 
   long frames_left = data_ptr->size_frames - data_ptr->frame_index;
@@ -40,24 +42,14 @@ int recordCallback(const void* input_buf, void* output_buf,
     done_or_continue = paComplete;
   }
 
-  if (input_buf != NULL)
-  {
-    for (int i=0; i<frames_provided; i++)
-    {
-      recorded_samples->push_back(*cur_in++); // left or mono
-      if (g_num_channels == 2)
-        recorded_samples->push_back(*cur_in++); // right
-    }
-  }
-  else
-  {
-    for (int i=0; i<frames_provided; i++)
-    {
-      recorded_samples->push_back(kSilentSample);  // left or mono
-      if (g_num_channels == 2)
-        recorded_samples->push_back(kSilentSample);  // right
-    }
-  }
+  Sample* dest = data_ptr->samples.data() +
+                 data_ptr->frame_index * data_ptr->stored_channels;
+  if (input_buf == NULL)
+    std::fill(dest, dest + frames_provided * data_ptr->stored_channels, kSilentSample);
+  else if (data_ptr->stored_channels == g_num_channels)
+    memcpy(dest, cur_in, frames_provided * g_num_channels * sizeof(Sample));
+  else // stereo input, mono storage
+    downmixStereo(cur_in, dest, frames_provided);
   data_ptr->frame_index += frames_provided;
   return done_or_continue;
 }
@@ -237,8 +229,9 @@ PaDeviceIndex chooseInputDevice()
   return writeDeviceConfig(dev_names, chosen);
 }
 
-AudioInput::AudioInput(int seconds_to_record, int frames_per_cb)
-  : stream_(nullptr), data_(seconds_to_record * kFramesPerSec)
+AudioInput::AudioInput(int seconds_to_record, int frames_per_cb, bool store_mono)
+  : stream_(nullptr),
+    data_(seconds_to_record * kFramesPerSec, store_mono ? 1 : g_num_channels)
 {
   ctorCommon(recordCallback, &data_, frames_per_cb, kFramesPerSec, paFloat32, g_num_channels);
 }
@@ -247,7 +240,7 @@ AudioInput::AudioInput(int(*custom_record_cb)(const void*, void*, unsigned long,
                        const PaStreamCallbackTimeInfo*,
                        PaStreamCallbackFlags, void*), void* user_opaque,
                        int frames_per_cb, int frame_rate, int sample_format, int n_channels)
-  : stream_(nullptr), data_(0)
+  : stream_(nullptr), data_(0, g_num_channels)
 {
   ctorCommon(custom_record_cb, user_opaque, frames_per_cb, frame_rate, sample_format, n_channels);
 }
@@ -314,6 +307,11 @@ std::vector<Sample> const& AudioInput::recordedSamples()
   return data_.samples;
 }
 
+int AudioInput::recordedChannels() const
+{
+  return data_.stored_channels;
+}
+
 long* AudioInput::frame_index_ptr()
 {
   return data_.frame_index_ptr();
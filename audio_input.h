@@ -9,21 +9,24 @@
 
 struct RecordingState
 {
-  RecordingState(long size_in_frames) : size_frames(size_in_frames)
-  {
-    // HACK: assume g_num_channels is 2. a bit wasteful if actually 1, but fine.
-    samples.reserve(size_frames * 2);
-  }
+  // stored_channels: g_num_channels to keep the audio as captured, or 1 to
+  // have it downmixed to mono as it comes in.
+  RecordingState(long size_in_frames, int stored_channels)
+    : size_frames(size_in_frames), stored_channels(stored_channels),
+      samples(size_in_frames * stored_channels, kSilentSample) {}
   long* frame_index_ptr()
   {
     return &frame_index;
   }
 
-  // *frame-based* index into samples. So, if g_num_channels==2, frame_index 2 is
-  // actually pointing to samples[4] (and 5).
+  // *frame-based* index into samples. So, if stored_channels==2, frame_index 2
+  // is actually pointing to samples[4] (and 5).
   long frame_index = 0;
-  // intended final size of samples, again specified in frames rather than samples.
+  // final size of samples, again specified in frames rather than samples.
   const long size_frames;
+  const int stored_channels;
+  // Allocated at full size up front, so recordCallback() only ever copies
+  // whole callback buffers into it. (Frames not yet recorded are silent).
   std::vector<Sample> samples;
 };
 
@@ -35,8 +38,10 @@ int recordCallback(const void* input_buf, void* output_buf,
 class AudioInput
 {
 public:
-  // Call me for a nice straightforward recording of audio.
-  AudioInput(int seconds_to_record, int frames_per_cb);
+  // Call me for a nice straightforward recording of audio. If store_mono,
+  // stereo input is downmixed, halving the memory (and later processing) of
+  // recordings that are only going to be downmixed anyway, e.g. for training.
+  AudioInput(int seconds_to_record, int frames_per_cb, bool store_mono = false);
   // Call me if you want an audio input stream, and want to do your own stuff with it.
   AudioInput(int(*custom_record_cb)(const void*, void*, unsigned long,
                                     const PaStreamCallbackTimeInfo*,
@@ -54,10 +59,11 @@ public:
 
   bool active() const;
 
-  // Access the recorded audio. Will be empty if you used the non-default ctor.
-  // Perhaps ok to access while recording is ongoing, if you're ok with concurrent
-  // reading+appending of an unprotected vector.
+  // Access the recorded audio, interleaved recordedChannels() channels. Will be
+  // empty if you used the non-default ctor. Never reallocated, so ok to read
+  // while recording is ongoing, if you stay behind *frame_index_ptr().
   std::vector<Sample> const& recordedSamples();
+  int recordedChannels() const;
 
   // For querying current frame of ongoing recording.
   long* frame_index_ptr();
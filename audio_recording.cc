@@ -1,13 +1,23 @@
 #include "audio_recording.h"
 
-#include <cassert>
 #include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <thread>
 
 #include "audio_input.h"
 #include "audio_output.h"
+#include "dsp_kernels.h"
 #include "interaction.h"
 
+#ifndef CLICKITONGUE_WINDOWS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 void crash(const char* s);
 
 // (don't want to incude weird networking headers just to get htons)
@@ -18,43 +28,114 @@ bool isLittleEndian()
   return as_bytes[0] == 1;
 }
 
-uint16_t swap16(uint16_t value)
-{
-  return (value << 8) | (value >> 8);
-}
+namespace {
 
-AudioRecording::AudioRecording(std::string fname)
+// A whole file's contents, read-only. mmapped where we can, so the loader
+// reads straight out of the page cache rather than through stdio.
+class FileBytes
 {
-  bool little_endian = isLittleEndian();
-  FILE* reader = fopen(fname.c_str(), "rb");
-  if (!reader)
+public:
+  explicit FileBytes(std::string const& fname)
+  {
+#ifdef CLICKITONGUE_WINDOWS
+    FILE* reader = fopen(fname.c_str(), "rb");
+    if (!reader)
+      crashCouldNotOpen(fname);
+    fseek(reader, 0, SEEK_END);
+    buf_.resize(ftell(reader));
+    rewind(reader);
+    size_ = fread(buf_.data(), 1, buf_.size(), reader);
+    fclose(reader);
+    data_ = buf_.data();
+#else
+    int fd = open(fname.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0)
+      crashCouldNotOpen(fname);
+    size_ = st.st_size;
+    if (size_ > 0)
+    {
+      void* mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapped == MAP_FAILED)
+        crashCouldNotOpen(fname);
+      madvise(mapped, size_, MADV_SEQUENTIAL);
+      data_ = static_cast<const uint8_t*>(mapped);
+    }
+    close(fd); // (the mapping stays valid)
+#endif
+  }
+  ~FileBytes()
+  {
+#ifndef CLICKITONGUE_WINDOWS
+    if (data_)
+      munmap(const_cast<uint8_t*>(data_), size_);
+#endif
+  }
+  FileBytes(FileBytes const&) = delete;
+  FileBytes& operator=(FileBytes const&) = delete;
+
+  const uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+
+private:
+  static void crashCouldNotOpen(std::string const& fname)
   {
     std::string msg = "could not open "+fname+". crashing.";
     crash(msg.c_str());
   }
-  fseek(reader, 0, SEEK_END);
-  size_t flen = ftell(reader);
-  rewind(reader);
-  for (size_t bytes_read = 0; bytes_read < flen; bytes_read += sizeof(uint16_t))
+
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+#ifdef CLICKITONGUE_WINDOWS
+  std::vector<uint8_t> buf_;
+#endif
+};
+
+// The inverse of decodeBigEndianPCM(), clipping to [-1, 1].
+void encodeBigEndianPCM(const float* samples, size_t num_samples, uint8_t* bytes)
+{
+  for (size_t i = 0; i < num_samples; i++)
   {
-    uint16_t cur16;
-    assert(1 == fread(&cur16, sizeof(uint16_t), 1, reader));
-    if (little_endian)
-      cur16 = swap16(cur16);
-    double temp = cur16;
-    temp -= 32768.0;
-    temp /= 32767.0;
-    samples_.push_back((float)temp);
+    uint16_t sample16;
+    double temp = ((double)samples[i]) * 32767.0 + 32768.0;
+    if (temp > 65534.5)
+      sample16 = 65535;
+    else if (temp < 0.5)
+      sample16 = 0;
+    else
+      sample16 = (uint16_t)(((uint32_t)(temp*2.0))/2);
+    bytes[2*i] = sample16 >> 8;
+    bytes[2*i + 1] = sample16 & 0xff;
   }
-  fclose(reader);
 }
 
-AudioRecording::AudioRecording(int seconds)
+} // namespace
+
+AudioRecording::AudioRecording(std::string fname)
 {
-  AudioInput recorder(seconds, paFramesPerBufferUnspecified);
+  FileBytes file(fname);
+  samples_.resize(file.size() / sizeof(uint16_t));
+  decodeBigEndianPCM(file.data(), samples_.data(), samples_.size());
+}
+
+AudioRecording const& bundledRecording(std::string const& fname)
+{
+  static std::mutex* mutex = new std::mutex;
+  static auto* cache = new std::map<std::string, std::unique_ptr<AudioRecording>>;
+  const std::lock_guard<std::mutex> lock(*mutex);
+  std::unique_ptr<AudioRecording>& entry = (*cache)[fname];
+  if (!entry)
+    entry = std::make_unique<AudioRecording>(fname);
+  return *entry;
+}
+
+AudioRecording::AudioRecording(int seconds, bool store_mono)
+{
+  AudioInput recorder(seconds, paFramesPerBufferUnspecified, store_mono);
   while (recorder.active())
     Pa_Sleep(100);
   samples_ = recorder.recordedSamples();
+  num_channels_ = recorder.recordedChannels();
 }
 
 int recordIndefinitelyCallback(const void* input_buf, void* output_buf,
@@ -106,15 +187,46 @@ AudioRecording::AudioRecording(PokeQueue* stop_recording, std::string fname, Pok
 
 void AudioRecording::play() const
 {
-  playRecorded(&samples_);
+  if (num_channels_ == g_num_channels)
+  {
+    playRecorded(&samples_);
+    return;
+  }
+  // Mono storage; play it on every channel.
+  std::vector<float> interleaved;
+  interleaved.reserve(samples_.size() * g_num_channels);
+  for (float sample : samples_)
+    interleaved.insert(interleaved.end(), g_num_channels, sample);
+  playRecorded(&interleaved);
 }
 
 std::vector<float> const& AudioRecording::samples() const { return samples_; }
+int AudioRecording::numChannels() const { return num_channels_; }
+
+void AudioRecording::downmixToMono()
+{
+  if (num_channels_ == 1)
+    return;
+  downmixStereo(samples_.data(), samples_.data(), samples_.size() / 2);
+  samples_.resize(samples_.size() / 2);
+  num_channels_ = 1;
+}
 
 AudioRecording& AudioRecording::operator+=(AudioRecording const& rhs)
 {
-  for (int i = 0; i < samples_.size() && i < rhs.samples().size(); i++)
-    samples_[i] += rhs.samples()[i];
+  const std::vector<float>& rhs_samples = rhs.samples();
+  if (num_channels_ == rhs.numChannels())
+  {
+    for (int i = 0; i < samples_.size() && i < rhs_samples.size(); i++)
+      samples_[i] += rhs_samples[i];
+  }
+  else if (num_channels_ == 1 && rhs.numChannels() == 2)
+  {
+    for (int i = 0; i < samples_.size() && 2*i + 1 < rhs_samples.size(); i++)
+      samples_[i] += (rhs_samples[2*i] + rhs_samples[2*i + 1]) / 2.0f;
+  }
+  else
+    crash("can't add a mono recording onto a stereo one");
   return *this;
 }
 
@@ -126,26 +238,20 @@ void AudioRecording::scale(double factor)
 
 void AudioRecording::recordToFile(std::string fname) const
 {
-  bool little_endian = isLittleEndian();
+  std::vector<uint8_t> bytes(samples_.size() * sizeof(uint16_t));
+  encodeBigEndianPCM(samples_.data(), samples_.size(), bytes.data());
   FILE* writer = fopen(fname.c_str(), "wb");
-  for (float sample : samples_)
+  if (!writer || fwrite(bytes.data(), 1, bytes.size(), writer) != bytes.size())
   {
-    uint16_t sample16;
-    double temp = ((double)sample) * 32767.0 + 32768.0;
-    if (temp > 65534.5)
-      sample16 = 65535;
-    else if (temp < 0.5)
-      sample16 = 0;
-    else
-      sample16 = (uint16_t)(((uint32_t)(temp*2.0))/2);
-    if (little_endian)
-      sample16 = swap16(sample16);
-    fwrite(&sample16, sizeof(uint16_t), 1, writer);
+    PRINTERR(stderr, "failed to write %s\n", fname.c_str());
+    if (writer)
+      fclose(writer);
+    return;
   }
   fclose(writer);
-  float seconds = (samples_.size() / g_num_channels) / (float)kFramesPerSec;
+  float seconds = (samples_.size() / num_channels_) / (float)kFramesPerSec;
   PRINTF("Wrote %g seconds of big-endian uint16 %d channel %d Hz audio to %s.\n",
-         seconds, g_num_channels, kFramesPerSec, fname.c_str());
+         seconds, num_channels_, kFramesPerSec, fname.c_str());
 }
 
 bool writeS16ToFile(std::string filename, const std::vector<int16_t>& s16_samples)
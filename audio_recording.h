@@ -5,17 +5,21 @@
 #include <vector>
 
 #include "blocking_queue.h"
+#include "constants.h"
 
 // For saving/loading raw PCM files. Reads/writes files with big-endian uint16
-// samples, but stores in memory as 32-bit float.
+// samples, but stores in memory as 32-bit float. Samples are interleaved
+// numChannels() channels: g_num_channels, unless stored as mono.
 class AudioRecording
 {
 public:
-  // Loads fname as raw big-endian uint16 PCM
+  // Loads fname as raw big-endian uint16 PCM. (For the files bundled in data/,
+  // use bundledRecording() instead).
   explicit AudioRecording(std::string fname);
   // Records 'seconds' of audio into samples_. (This ctor blocks until those
-  // seconds of recording have finished).
-  explicit AudioRecording(int seconds);
+  // seconds of recording have finished). store_mono: downmix as it's recorded;
+  // for audio that will only ever be fed to the FFT, which downmixes anyway.
+  explicit AudioRecording(int seconds, bool store_mono = false);
   // Record into samples_ until stop_recording fires, then writes a WAV file to fname.
   AudioRecording(PokeQueue* stop_recording, std::string fname, PokeQueue* wav_ready);
 
@@ -24,10 +28,15 @@ public:
   // write samples_ to fname
   void recordToFile(std::string fname) const;
   void writeToWAVFile(std::string fname) const;
-  // accessor
+  // accessors
   std::vector<float> const& samples() const;
+  int numChannels() const;
+
+  // (L+R)/2, exactly as the FFT would have downmixed us.
+  void downmixToMono();
 
   // Overlays rhs onto our own data. We ignore its end if it's longer than we are.
+  // If we're mono and rhs is stereo, rhs is downmixed as it's added.
   AudioRecording& operator+=(AudioRecording const& rhs);
   // Scale up or down by this factor.
   void scale(double factor);
@@ -36,7 +45,13 @@ public:
   // worst case it records one frame longer than intended
   bool keep_recording_ = true;
   std::vector<float> samples_;
+  int num_channels_ = g_num_channels;
   std::vector<int16_t> hack_s16_samples_;
 };
 
+// data/noise*.pcm and data/breath.pcm, which every training run mixes into its
+// examples: each file is decoded on first use, then shared by later calls for
+// the rest of the process. Thread safe.
+AudioRecording const& bundledRecording(std::string const& fname);
+
 #endif // CLICKITONGUE_AUDIO_RECORDING_H_
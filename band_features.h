@@ -0,0 +1,170 @@
+#ifndef CLICKITONGUE_BAND_FEATURES_H_
+#define CLICKITONGUE_BAND_FEATURES_H_
+
+#include <array>
+#include <cstdint>
+
+#include "constants.h"
+#include "dsp_kernels.h"
+#include "easy_fourier.h"
+
+constexpr int log2Int(int x) { return x <= 1 ? 0 : 1 + log2Int(x / 2); }
+
+// Octave k (for 1 <= k <= kNumOctaves) is bins [2^(k-1), 2^k) of a
+// kDefaultFourierBlocksize block: o1 is bin 1, o2 is bins 2+3, o3 is bins
+// 4+5+6+7,... ...o5 is bins 16+17+...+31, o6 is 32+...+63, o7 is 64+...+127.
+// Octave 0 is the DC bin.
+//
+// The octaves are defined by those frequencies, whatever the block size; see
+// octaveBins().
+//
+// Each detector reads two octaves, named in its header as k<Type>LowOctave and
+// k<Type>HighOctave; its parameter names refer to them by number, e.g. the
+// blow detector's o1_on_thresh and o7_on_thresh.
+constexpr int kNumOctaves = log2Int(kDefaultFourierBlocksize) - 1;
+
+struct BinRange
+{
+  int begin;
+  int end; // exclusive
+};
+
+// The bins making up octave k at this block size: those whose center
+// frequencies fall within the octave's band (whose edges are halfway between
+// kDefaultFourierBlocksize bins). If blocks are too short to resolve the band
+// at all, it's the single bin just above its lower edge.
+constexpr BinRange octaveBins(int blocksize, int k)
+{
+  if (k == 0)
+    return BinRange{0, 1};
+  auto ceil_int = [](double x) { int i = (int)x; return i < x ? i + 1 : i; };
+  const double bins_per_default_bin = (double)blocksize / kDefaultFourierBlocksize;
+  const int begin = ceil_int(((1 << (k-1)) - 0.5) * bins_per_default_bin);
+  const int end = ceil_int(((1 << k) - 0.5) * bins_per_default_bin);
+  return BinRange{begin, end > begin ? end : begin + 1};
+}
+static_assert(octaveBins(kDefaultFourierBlocksize, 7).begin == 64 &&
+              octaveBins(kDefaultFourierBlocksize, 7).end == 128);
+
+constexpr std::array<BinRange, kNumOctaves + 1> octaveBinTable(int blocksize)
+{
+  std::array<BinRange, kNumOctaves + 1> ret{};
+  for (int k = 0; k <= kNumOctaves; k++)
+    ret[k] = octaveBins(blocksize, k);
+  return ret;
+}
+
+// How far back (including the current block) the recent_* fields of
+// BandFeatures look: hopsIn(kBandHistoryMs, hop) blocks.
+constexpr double kBandHistoryMs = 58;
+constexpr int kMaxBandHistoryBlocks = hopsIn(kBandHistoryMs, kMinFourierHop);
+
+// Everything the detectors look at for one block of audio. Computed once per
+// block by BandFeatureStage, and shared by all detectors.
+struct BandFeatures
+{
+  // Total (scaled) power in octave k is octave[k]. octave[0] is the DC bin.
+  double octave[kNumOctaves + 1] = {0};
+  // Max and sum of octave[k] over the last kBandHistoryMs of blocks.
+  // Blocks from before the start of the stream count as 0.
+  double recent_max[kNumOctaves + 1] = {0};
+  double recent_sum[kNumOctaves + 1] = {0};
+  // The hum's pitch in Hz (see ZoomPitchTracker), if the pipeline is tracking
+  // it and there is a clear one; else 0.
+  double pitch_hz = 0;
+};
+
+// The last len values pushed into a stream (len <= kMaxLen), with amortized
+// O(1) max and sum. Values are assumed to be >= 0 (the initial, not-yet-pushed
+// slots are 0).
+template<int kMaxLen>
+class RollingWindow
+{
+public:
+  explicit RollingWindow(int len = kMaxLen) : len_(len) {}
+
+  void push(double x)
+  {
+    // Drop the max candidate that is about to fall out of the window, then
+    // any candidates that x makes irrelevant.
+    if (size_ > 0 && maxq_[head_].index <= count_ - len_)
+    {
+      head_ = wrap(head_ + 1);
+      size_--;
+    }
+    while (size_ > 0 && maxq_[wrap(head_ + size_ - 1)].val <= x)
+      size_--;
+    maxq_[wrap(head_ + size_)] = Candidate{count_, x};
+    size_++;
+
+    sum_ += x - vals_[next_];
+    vals_[next_] = x;
+    count_++;
+    if (++next_ == len_)
+    {
+      // Recompute from scratch once per lap, so rounding error can't pile up.
+      next_ = 0;
+      sum_ = 0;
+      for (int i = 0; i < len_; i++)
+        sum_ += vals_[i];
+    }
+  }
+  double max() const { return size_ > 0 ? maxq_[head_].val : 0; }
+  double sum() const { return sum_; }
+
+private:
+  struct Candidate { int64_t index; double val; };
+
+  // i mod len_, for 0 <= i < 2*len_.
+  int wrap(int i) const { return i < len_ ? i : i - len_; }
+
+  int len_;
+  double vals_[kMaxLen] = {0};
+  int next_ = 0; // the slot of vals_ the next push overwrites
+  int64_t count_ = 0; // total values ever pushed
+  double sum_ = 0;
+  // Ring buffer of decreasing values (with their push indices); the front is
+  // the max of the window.
+  Candidate maxq_[kMaxLen];
+  int head_ = 0;
+  int size_ = 0;
+};
+
+// Turns each kBlocksize block's power spectrum into BandFeatures, maintaining
+// the history behind their recent_* fields. Use one per audio stream.
+template<int kBlocksize>
+class BandFeatureStage
+{
+public:
+  // hop: frames from one block to the next.
+  explicit BandFeatureStage(int hop = kBlocksize)
+  {
+    for (auto& history : history_)
+      history = RollingWindow<kMaxBandHistoryBlocks>(hopsIn(kBandHistoryMs, hop));
+  }
+
+  // freq_power[i][0] is bin i's power, for the kBlocksize/2 + 1 bins. The
+  // returned reference is valid until the next call.
+  BandFeatures const& process(const FourierComplex* freq_power, double pitch_hz = 0)
+  {
+    cur_.pitch_hz = pitch_hz;
+    for (int k = 0; k <= kNumOctaves; k++)
+    {
+      cur_.octave[k] = sumPowers(freq_power, kOctaves[k].begin, kOctaves[k].end);
+      history_[k].push(cur_.octave[k]);
+      cur_.recent_max[k] = history_[k].max();
+      cur_.recent_sum[k] = history_[k].sum();
+    }
+    return cur_;
+  }
+
+private:
+  static constexpr std::array<BinRange, kNumOctaves + 1> kOctaves =
+      octaveBinTable(kBlocksize);
+  static_assert(kOctaves[kNumOctaves].end <= kBlocksize/2 + 1);
+
+  BandFeatures cur_;
+  RollingWindow<kMaxBandHistoryBlocks> history_[kNumOctaves + 1];
+};
+
+#endif // CLICKITONGUE_BAND_FEATURES_H_
@@ -0,0 +1,314 @@
+#ifdef CLICKITONGUE_BENCH
+
+// Microbenchmarks of the click path and training, plus full training runs on
+// the bundled recordings. Build with ./build.sh bench.ccbuildfile, and run
+// ./clickitongue_bench [output.json] from the repository root (so that data/
+// is found). Results go to output.json (default clickitongue_bench.json).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "audio_recording.h"
+#include "blow_detector.h"
+#include "cat_detector.h"
+#include "easy_fourier.h"
+#include "fft_result_distributor.h"
+#include "hum_detector.h"
+#include "sliding_dft.h"
+#include "spectrogram.h"
+#include "spectrum_pipeline.h"
+#include "train_blow.h"
+#include "train_cat.h"
+#include "train_hum.h"
+#include "training_seed.h"
+
+void safelyExit(int exit_code);
+
+namespace {
+
+constexpr uint32_t kTrainingSeed = 12345;
+
+struct BenchResult
+{
+  std::string name;
+  double ns_per_op;
+  int64_t ops;
+};
+
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Calls op() in rounds of enough iterations to take at least 50ms, and
+// reports the median round's time per call.
+template<class F>
+BenchResult runBench(std::string name, F op)
+{
+  int64_t iterations = 1;
+  while (true)
+  {
+    auto start = std::chrono::steady_clock::now();
+    for (int64_t i = 0; i < iterations; i++)
+      op();
+    if (secondsSince(start) >= 0.05)
+      break;
+    iterations *= 2;
+  }
+  std::vector<double> round_ns;
+  for (int round = 0; round < 5; round++)
+  {
+    auto start = std::chrono::steady_clock::now();
+    for (int64_t i = 0; i < iterations; i++)
+      op();
+    round_ns.push_back(secondsSince(start) * 1e9 / iterations);
+  }
+  std::sort(round_ns.begin(), round_ns.end());
+  BenchResult ret{name, round_ns[round_ns.size() / 2], iterations * 5};
+  printf("%-40s %12.1f ns/op\n", name.c_str(), ret.ns_per_op);
+  return ret;
+}
+
+std::vector<std::unique_ptr<Detector>> makeBenchDetectors(
+    ActionRing* action_queue)
+{
+  // Typical trained values; the bundled recordings trigger each now and then.
+  std::vector<std::unique_ptr<Detector>> ret;
+  ret.push_back(std::make_unique<BlowDetector>(
+      action_queue, Action::NoAction, Action::NoAction, 500, 50, 5, 3, true));
+  ret.push_back(std::make_unique<CatDetector>(
+      action_queue, Action::NoAction, Action::NoAction, 90, 800, true));
+  ret.push_back(std::make_unique<HumDetector>(
+      action_queue, Action::NoAction, Action::NoAction, 2575, 257, 278, 0.3, true));
+  return ret;
+}
+
+void benchProcessAudio(AudioRecording const& audio, std::vector<BenchResult>* results)
+{
+  ActionRing action_queue;
+  FFTResultDistributor distrib(makeBenchDetectors(&action_queue), 1.0,
+                               /*training=*/true);
+  std::vector<float> const& samples = audio.samples();
+  const int block_len = distrib.inputBlocksize() * g_num_channels;
+  const int num_blocks = samples.size() / block_len;
+  int block_ind = 0;
+  results->push_back(runBench("FFTResultDistributor::processAudio", [&]()
+  {
+    distrib.processAudio(samples.data() + block_ind * block_len, distrib.inputBlocksize());
+    block_ind = (block_ind + 1) % num_blocks;
+  }));
+}
+
+// The FFT SpectrumPipeline at each supported block size (per block, so a
+// 1024 block costs ~4x a 256 block just to break even), and with pitch
+// tracking (for HumScrollDetector); then, at the default block size, a
+// sliding DFT of the bins the detectors read (and of bin 1 alone, for scale).
+void benchSpectrum(AudioRecording const& audio, std::vector<BenchResult>* results)
+{
+  std::vector<float> const& samples = audio.samples();
+  std::vector<std::pair<int, bool>> variants; // (block size, track pitch)
+  for (int blocksize : kSupportedBlocksizes)
+    variants.emplace_back(blocksize, false);
+  variants.emplace_back(kDefaultFourierBlocksize, true);
+  for (auto [blocksize, track_pitch] : variants)
+  {
+    SpectrumPipelineOptions options;
+    options.track_pitch = track_pitch;
+    std::unique_ptr<SpectrumPipeline> pipeline =
+        makeSpectrumPipeline(blocksize, audio.numChannels(), 1.0, options);
+    const int block_len = blocksize * audio.numChannels();
+    const int num_blocks = samples.size() / block_len;
+    int block_ind = 0;
+    results->push_back(runBench(
+        "SpectrumPipeline (" + std::to_string(blocksize) + " frames" +
+            (track_pitch ? ", pitch" : "") + ")", [&]()
+    {
+      pipeline->process(samples.data() + block_ind * block_len);
+      block_ind = (block_ind + 1) % num_blocks;
+    }));
+  }
+
+  constexpr int kBlocksize = kDefaultFourierBlocksize;
+  const int block_len = kBlocksize * audio.numChannels();
+  const int num_blocks = samples.size() / block_len;
+  int block_ind = 0;
+  std::vector<FourierComplex> power(SlidingDft<kBlocksize>::kNumBins);
+  std::vector<int> detector_octaves = {kBlowLowOctave, kBlowHighOctave,
+                                      kCatLowOctave, kCatHighOctave,
+                                      kHumLowOctave, kHumHighOctave};
+  std::sort(detector_octaves.begin(), detector_octaves.end());
+  detector_octaves.erase(
+      std::unique(detector_octaves.begin(), detector_octaves.end()),
+      detector_octaves.end());
+  std::pair<std::string, std::vector<int>> bin_sets[] = {
+      {"SlidingDft (detector bins)", binsOfOctaves(kBlocksize, detector_octaves)},
+      {"SlidingDft (bin 1 only)", {1}}};
+  for (auto const& [name, bins] : bin_sets)
+  {
+    SlidingDft<kBlocksize> sliding_dft(bins);
+    results->push_back(runBench(name, [&]()
+    {
+      const Sample* frames = samples.data() + block_ind * block_len;
+      if (audio.numChannels() == 2)
+        sliding_dft.push<2>(frames, kBlocksize);
+      else
+        sliding_dft.push<1>(frames, kBlocksize);
+      sliding_dft.power(power.data(), 1.0);
+      block_ind = (block_ind + 1) % num_blocks;
+    }));
+  }
+}
+
+void benchDetectors(AudioRecording const& audio, std::vector<BenchResult>* results)
+{
+  Spectrogram spectra(audio.samples(), audio.numChannels(), 1.0);
+  ActionRing action_queue;
+  std::vector<std::unique_ptr<Detector>> detectors = makeBenchDetectors(&action_queue);
+  const char* names[] = {"BlowDetector::processBlock", "CatDetector::processBlock",
+                         "HumDetector::processBlock"};
+  for (int i = 0; i < detectors.size(); i++)
+  {
+    Detector* detector = detectors[i].get();
+    int block_ind = 0;
+    results->push_back(runBench(names[i], [&]()
+    {
+      detector->processBlock(spectra.block(block_ind));
+      block_ind = (block_ind + 1) % spectra.numBlocks();
+    }));
+  }
+}
+
+void benchBorrowWorker(std::vector<BenchResult>* results)
+{
+  results->push_back(runBench("EasyFourier::borrowWorker", []()
+  {
+    FourierLease lease = g_fourier->borrowWorker();
+  }));
+
+  // Every core borrowing at once; reported per borrow, across all threads.
+  const int num_threads = std::max(2u, std::thread::hardware_concurrency());
+  constexpr int kBorrowsPerThread = 100000;
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++)
+  {
+    threads.emplace_back([]()
+    {
+      for (int j = 0; j < kBorrowsPerThread; j++)
+        FourierLease lease = g_fourier->borrowWorker();
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  int64_t ops = (int64_t)num_threads * kBorrowsPerThread;
+  BenchResult contended{"EasyFourier::borrowWorker (" + std::to_string(num_threads) +
+                            " threads)",
+                        secondsSince(start) * 1e9 / ops, ops};
+  printf("%-40s %12.1f ns/op\n", contended.name.c_str(), contended.ns_per_op);
+  results->push_back(contended);
+}
+
+void benchAudioRecording(std::vector<BenchResult>* results)
+{
+  results->push_back(runBench("AudioRecording load", []()
+  {
+    AudioRecording loaded("data/noise1.pcm");
+  }));
+  AudioRecording base("data/noise1.pcm");
+  AudioRecording other("data/noise2.pcm");
+  results->push_back(runBench("AudioRecording::scale", [&]()
+  {
+    base.scale(1.0001);
+  }));
+  results->push_back(runBench("AudioRecording::operator+=", [&]()
+  {
+    base += other;
+  }));
+}
+
+struct TrainingResult
+{
+  std::string name;
+  double ms;
+  bool enabled;
+};
+
+template<class F>
+TrainingResult timeTraining(std::string name, F train)
+{
+  setTrainingSeed(kTrainingSeed);
+  auto start = std::chrono::steady_clock::now();
+  bool enabled = train().enabled;
+  TrainingResult ret{name, secondsSince(start) * 1000.0, enabled};
+  printf("\n%-40s %12.0f ms\n", name.c_str(), ret.ms);
+  return ret;
+}
+
+void writeJSON(std::string path, std::vector<BenchResult> const& benches,
+               std::vector<TrainingResult> const& trainings)
+{
+  FILE* out = fopen(path.c_str(), "wt");
+  if (!out)
+  {
+    fprintf(stderr, "couldn't open %s for writing\n", path.c_str());
+    return;
+  }
+  fprintf(out, "{\n  \"benchmarks\": [\n");
+  for (int i = 0; i < benches.size(); i++)
+  {
+    fprintf(out, "    {\"name\": \"%s\", \"ns_per_op\": %.2f, \"ops\": %lld}%s\n",
+            benches[i].name.c_str(), benches[i].ns_per_op,
+            (long long)benches[i].ops, i + 1 < benches.size() ? "," : "");
+  }
+  fprintf(out, "  ],\n  \"training\": [\n");
+  for (int i = 0; i < trainings.size(); i++)
+  {
+    fprintf(out, "    {\"name\": \"%s\", \"seed\": %u, \"ms\": %.1f, \"enabled\": %s}%s\n",
+            trainings[i].name.c_str(), kTrainingSeed, trainings[i].ms,
+            trainings[i].enabled ? "true" : "false",
+            i + 1 < trainings.size() ? "," : "");
+  }
+  fprintf(out, "  ]\n}\n");
+  fclose(out);
+  printf("wrote %s\n", path.c_str());
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  std::string json_path = argc > 1 ? argv[1] : "clickitongue_bench.json";
+  g_fourier = new EasyFourier();
+
+  // Stand-ins for user recordings: not real blows/cats/hums, but the same
+  // amount of audio a real training run chews through.
+  std::vector<std::pair<AudioRecording, int>> examples;
+  examples.emplace_back(AudioRecording("data/breath.pcm"), 2);
+  examples.emplace_back(AudioRecording("data/noise1.pcm"), 0);
+  examples.emplace_back(AudioRecording("data/noise2.pcm"), 1);
+  std::vector<TrainingResult> trainings;
+  trainings.push_back(timeTraining("trainBlow", [&]() {
+    return trainBlow(examples, 1.0, /*mic_near_mouth=*/true); }));
+  trainings.push_back(timeTraining("trainCat", [&]() {
+    return trainCat(examples, 1.0, /*mic_near_mouth=*/false); }));
+  trainings.push_back(timeTraining("trainHum", [&]() {
+    return trainHum(examples, 1.0, /*mic_near_mouth=*/false); }));
+
+  AudioRecording breath("data/breath.pcm");
+  std::vector<BenchResult> benches;
+  benchSpectrum(breath, &benches);
+  benchDetectors(breath, &benches);
+  benchBorrowWorker(&benches);
+  benchAudioRecording(&benches);
+  benchProcessAudio(breath, &benches);
+
+  writeJSON(json_path, benches, trainings);
+  safelyExit(0);
+}
+
+#endif // CLICKITONGUE_BENCH
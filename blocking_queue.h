@@ -3,8 +3,7 @@
 
 #include <atomic>
 #include <condition_variable>
-#include <optional>
-#include <queue>
+#include <mutex>
 
 // Allows an enqueuer to queue up event notifications, and a dequeuer to block
 // until there is one or more notifications enqueued.
@@ -31,43 +30,4 @@ private:
   std::atomic<int> pokes_outstanding_;
 };
 
-// Allows, thread-safely, one or more producers to enqueue() items, while a
-// consumer consumes any available items with deque(). If the queue is empty,
-// deque() blocks until something is enqueued, then returns that new thing.
-
-template<class T>
-class BlockingQueue
-{
-public:
-  void enqueue(T obj)
-  {
-    {
-      const std::lock_guard<std::mutex> lock(mu_);
-      q_.push(obj);
-    }
-    pokes_.poke();
-  }
-  // returns nullopt if the queue has shut down and the consumer should go away.
-  std::optional<T> deque()
-  {
-    pokes_.consumePoke();
-    const std::lock_guard<std::mutex> lock(mu_);
-    if (q_.empty())
-      return std::nullopt;
-    T obj = q_.front();
-    q_.pop();
-    return obj;
-  }
-  void shutdown()
-  {
-    pokes_.poke();
-  }
-
-private:
-  uint64_t last_action_msse_ = 0; // guarded by mu_
-  std::queue<T> q_; // guarded by mu_
-  std::mutex mu_;
-  PokeQueue pokes_;
-};
-
 #endif // CLICKITONGUE_BLOCKING_QUEUE_H_
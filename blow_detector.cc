@@ -1,6 +1,6 @@
 #include "blow_detector.h"
 
-BlowDetector::BlowDetector(BlockingQueue<Action>* action_queue,
+BlowDetector::BlowDetector(ActionRing* action_queue,
                            double o1_on_thresh, double o7_on_thresh,
                            double o7_off_thresh, int lookback_blocks,
                            bool require_delay,
@@ -9,9 +9,11 @@ BlowDetector::BlowDetector(BlockingQueue<Action>* action_queue,
     o1_on_thresh_(o1_on_thresh),
     o7_on_thresh_(o7_on_thresh), o7_off_thresh_(o7_off_thresh),
     lookback_blocks_(lookback_blocks), require_delay_(require_delay)
-{}
+{
+  resolutionChanged();
+}
 
-BlowDetector::BlowDetector(BlockingQueue<Action>* action_queue,
+BlowDetector::BlowDetector(ActionRing* action_queue,
                            Action action_on, Action action_off,
                            double o1_on_thresh, double o7_on_thresh,
                            double o7_off_thresh, int lookback_blocks,
@@ -20,7 +22,9 @@ BlowDetector::BlowDetector(BlockingQueue<Action>* action_queue,
     o1_on_thresh_(o1_on_thresh),
     o7_on_thresh_(o7_on_thresh), o7_off_thresh_(o7_off_thresh),
     lookback_blocks_(lookback_blocks), require_delay_(require_delay)
-{}
+{
+  resolutionChanged();
+}
 
 void updateMemory(double cur, double thresh, int* since)
 {
@@ -38,37 +42,23 @@ void BlowDetector::updateElevatedThreshs()
 {
   blocks_since_event_ = 0;
 
-  o1_elevated_thresh_ = 0;
-  for (int i=0; i<10; i++)
-    if (o1_recents_[i] > o1_elevated_thresh_)
-      o1_elevated_thresh_ = o1_recents_[i];
-  o1_elevated_thresh_ *= 0.9;
-  o7_elevated_thresh_ = 0;
-  for (int i=0; i<10; i++)
-    if (o7_recents_[i] > o7_elevated_thresh_)
-      o7_elevated_thresh_ = o7_recents_[i];
-  o7_elevated_thresh_ *= 0.9;
+  o1_elevated_thresh_ = 0.9 * o1_recent_max_;
+  o7_elevated_thresh_ = 0.9 * o7_recent_max_;
 }
 
-void BlowDetector::updateState(const fftw_complex* freq_power)
+void BlowDetector::updateState(BandFeatures const& features)
 {
-  o1_cur_ = freq_power[1][0];
-  o1_recents_[o1_recent_ind_] = o1_cur_;
-  if (++o1_recent_ind_ >= 10)
-    o1_recent_ind_ = 0;
-
-  o7_cur_ = 0;
-  for (int i=64; i<128; i++)
-    o7_cur_ += freq_power[i][0];
-  o7_recents_[o7_recent_ind_] = o7_cur_;
-  if (++o7_recent_ind_ >= 10)
-    o7_recent_ind_ = 0;
+  o1_cur_ = features.octave[kBlowLowOctave];
+  o1_recent_max_ = features.recent_max[kBlowLowOctave];
+  o7_cur_ = features.octave[kBlowHighOctave];
+  o7_recent_max_ = features.recent_max[kBlowHighOctave];
 
   double cur_o1_on_thresh = o1_on_thresh_;
   double cur_o7_on_thresh = o7_on_thresh_;
-  if (blocks_since_event_ < 30)
+  if (blocks_since_event_ < elevated_thresh_blocks_)
   {
-    double elevated_frac = (30.0 - (double)blocks_since_event_) / 30.0;
+    double elevated_frac = ((double)elevated_thresh_blocks_ - blocks_since_event_) /
+                           elevated_thresh_blocks_;
     double standard_frac = 1.0 - elevated_frac;
     // actually, going to allow these even if they are lower than the configured thresholds.
     //if (o1_elevated_thresh_ > o1_on_thresh_)
@@ -77,7 +67,7 @@ void BlowDetector::updateState(const fftw_complex* freq_power)
       cur_o7_on_thresh = standard_frac * o7_on_thresh_ + elevated_frac * o7_elevated_thresh_;
   }
 
-  if (blocks_since_event_ < 30)
+  if (blocks_since_event_ < elevated_thresh_blocks_)
     blocks_since_event_++;
 
   updateMemory(o1_cur_, cur_o1_on_thresh, &blocks_since_1above_);
@@ -86,11 +76,11 @@ void BlowDetector::updateState(const fftw_complex* freq_power)
 
 bool BlowDetector::shouldTransitionOn()
 {
-  bool activated = (blocks_since_1above_ <= lookback_blocks_ &&
-                    blocks_since_7above_ <= lookback_blocks_);
+  bool activated = (blocks_since_1above_ <= lookback_hop_blocks_ &&
+                    blocks_since_7above_ <= lookback_hop_blocks_);
   if (delay_blocks_left_ < 0 && activated)
   {
-    delay_blocks_left_ = kBlowDelayBlocks;
+    delay_blocks_left_ = delay_blocks_;
   }
   if (delay_blocks_left_ > 0 && (!require_delay_ || --delay_blocks_left_ == 0))
   {
@@ -107,19 +97,30 @@ bool BlowDetector::shouldTransitionOff()
 
   if (!under_threshs)
   {
-    deactivate_warmup_blocks_left_ = kBlowDeactivateWarmupBlocks;
+    deactivate_warmup_blocks_left_ = deactivate_warmup_blocks_;
     return false;
   }
   if (--deactivate_warmup_blocks_left_ <= 0)
   {
-    deactivate_warmup_blocks_left_ = kBlowDeactivateWarmupBlocks;
+    deactivate_warmup_blocks_left_ = deactivate_warmup_blocks_;
     updateElevatedThreshs();
     return true;
   }
   return false;
 }
 
-int BlowDetector::refracPeriodLengthBlocks() const { return 10; }
+int BlowDetector::refracPeriodLengthBlocks() const { return refrac_blocks_; }
+
+void BlowDetector::resolutionChanged()
+{
+  Detector::resolutionChanged();
+  delay_blocks_ = blocksIn(kBlowDelayMs);
+  deactivate_warmup_blocks_ = blocksIn(kBlowDeactivateWarmupMs);
+  refrac_blocks_ = blocksIn(kBlowRefracMs);
+  elevated_thresh_blocks_ = blocksIn(kBlowElevatedThreshMs);
+  lookback_hop_blocks_ = blocksAtHop(lookback_blocks_, hop());
+  deactivate_warmup_blocks_left_ = deactivate_warmup_blocks_;
+}
 
 void BlowDetector::resetEWMAs()
 {
@@ -1,41 +1,43 @@
 #include "cat_detector.h"
 
-CatDetector::CatDetector(BlockingQueue<Action>* action_queue,
+CatDetector::CatDetector(ActionRing* action_queue,
                          double o7_on_thresh, double o1_limit, bool use_limit,
                          std::vector<int>* cur_frame_dest)
   : Detector(Action::RecordCurFrame, Action::NoAction, action_queue, cur_frame_dest),
     o7_on_thresh_(o7_on_thresh), o1_limit_(o1_limit), use_limit_(use_limit),
     cur_o7_thresh_(o7_on_thresh_)
-{}
+{
+  resolutionChanged();
+}
 
-CatDetector::CatDetector(BlockingQueue<Action>* action_queue, Action action_on,
+CatDetector::CatDetector(ActionRing* action_queue, Action action_on,
                          Action action_off, double o7_on_thresh, double o1_limit,
                          bool use_limit)
   : Detector(action_on, action_off, action_queue),
     o7_on_thresh_(o7_on_thresh), o1_limit_(o1_limit), use_limit_(use_limit),
     cur_o7_thresh_(o7_on_thresh_)
-{}
+{
+  resolutionChanged();
+}
 
-void CatDetector::updateState(const fftw_complex* freq_power)
+void CatDetector::updateState(BandFeatures const& features)
 {
   if (use_limit_)
   {
-    if (freq_power[1][0] > o1_limit_)
+    if (features.octave[kCatLowOctave] > o1_limit_)
     {
-      o1_cooldown_blocks_ = 7;
-      cur_o7_thresh_ = o7_on_thresh_ + 7 * 2 * o7_on_thresh_;
+      o1_cooldown_blocks_ = o1_cooldown_length_blocks_;
+      cur_o7_thresh_ = o7_on_thresh_ + kCatO1Boost * o7_on_thresh_;
       warmed_up_ = false;
     }
     else if (o1_cooldown_blocks_ > 0)
     {
       o1_cooldown_blocks_--;
-      cur_o7_thresh_ -= 2 * o7_on_thresh_;
+      cur_o7_thresh_ -= (kCatO1Boost / o1_cooldown_length_blocks_) * o7_on_thresh_;
     }
   }
 
-  o7_cur_ = 0;
-  for (int i=64; i<128; i++)
-    o7_cur_ += freq_power[i][0];
+  o7_cur_ = features.octave[kCatHighOctave];
 }
 
 bool CatDetector::shouldTransitionOn()
@@ -59,6 +61,13 @@ bool CatDetector::shouldTransitionOff()
   return o7_cur_ < o7_on_thresh_;
 }
 
-int CatDetector::refracPeriodLengthBlocks() const { return 16; }
+int CatDetector::refracPeriodLengthBlocks() const { return refrac_blocks_; }
+
+void CatDetector::resolutionChanged()
+{
+  Detector::resolutionChanged();
+  refrac_blocks_ = blocksIn(kCatRefracMs);
+  o1_cooldown_length_blocks_ = blocksIn(kCatO1CooldownMs);
+}
 
 void CatDetector::resetEWMAs() {}
@@ -3,31 +3,36 @@
 
 #include "detector.h"
 
+constexpr double kCatRefracMs = 93;
+// How long an o1_limit violation keeps boosting the o7 threshold...
+constexpr double kCatO1CooldownMs = 41;
+// ...which it starts out boosting by this many o7_on_thresh, decaying
+// linearly back down over the cooldown.
+constexpr double kCatO1Boost = 14;
+constexpr int kCatLowOctave = 1;
+constexpr int kCatHighOctave = 7;
+
 class CatDetector : public Detector
 {
 public:
   // For training. Saves the frame indices of all detected events into
   // cur_frame_dest, and does nothing else.
-  CatDetector(BlockingQueue<Action>* action_queue,
+  CatDetector(ActionRing* action_queue,
               double o7_on_thresh, double o1_limit, bool use_limit,
               std::vector<int>* cur_frame_dest);
 
   // Kicks off action_on, action_off at each corresponding detected event.
-  CatDetector(BlockingQueue<Action>* action_queue,
+  CatDetector(ActionRing* action_queue,
               Action action_on, Action action_off,
               double o7_on_thresh, double o1_limit, bool use_limit);
 
 protected:
-  // IMPORTANT: although the type is fftw_complex, in fact freq_power[i][0] for
-  // each i is expected to be the squared magnitude (i.e. real^2 + imag_coeff^2)
-  // of the original complex number output at bin i.
-  // The imaginary coefficient (array index 1) is left untouched - although
-  // you're likely not at all interested in it.
-  void updateState(const fftw_complex* freq_power) override;
+  void updateState(BandFeatures const& features) override;
 
   bool shouldTransitionOn() override;
   bool shouldTransitionOff() override;
   int refracPeriodLengthBlocks() const override;
+  void resolutionChanged() override;
 
   void resetEWMAs() override;
 
@@ -50,6 +55,10 @@ private:
   bool warmed_up_ = false;
 
   int o1_cooldown_blocks_ = 0;
+
+  // The k*Ms durations, in blocks at the current hop().
+  int refrac_blocks_;
+  int o1_cooldown_length_blocks_;
 };
 
 #endif // CLICKITONGUE_CAT_DETECTOR_H_
@@ -10,14 +10,35 @@ struct ClickitongueCmdlineOpts
   std::optional<int> duration_seconds = 5;
   std::optional<bool> debug = false;
 
-  // record, play
+  // record, play, replay
   std::optional<std::string> filename;
+  // replay: which config profile's detectors to use. (Default: "default").
+  std::optional<std::string> config;
 
   std::optional<bool> retrain = false;
   std::optional<bool> forget_input_dev = false;
+
+  // Run the FFT and detectors in their own thread, rather than in the audio
+  // callback, with up to dsp_queue_blocks blocks of audio waiting for it.
+  std::optional<bool> dsp_thread = false;
+  std::optional<int> dsp_queue_blocks = 4;
+
+  // Frames per Fourier block (128, 256, 512, or 1024) to train at. Once
+  // trained, a config always runs at the block size it was trained at.
+  std::optional<int> blocksize;
+  // Per-detector overrides of blocksize, e.g. small blocks for quick
+  // reactions to transients (cat), big ones for finer frequencies (hum).
+  std::optional<int> blow_blocksize;
+  std::optional<int> cat_blocksize;
+  std::optional<int> hum_blocksize;
+  // Frames between decisions (a power of 2, from 32 up) to train at: if less
+  // than a detector's block size, its blocks overlap. Capped at each
+  // detector's block size; by default, equal to it.
+  std::optional<int> hop;
 };
 STRUCTOPT(ClickitongueCmdlineOpts,
-          mode, detector, duration_seconds, debug, filename,
-          retrain, forget_input_dev);
+          mode, detector, duration_seconds, debug, filename, config,
+          retrain, forget_input_dev, dsp_thread, dsp_queue_blocks,
+          blocksize, blow_blocksize, cat_blocksize, hum_blocksize, hop);
 
 #endif // CLICKITONGUE_CMDLINE_OPTIONS_H_
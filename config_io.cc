@@ -42,10 +42,40 @@ std::string actionString(Action action)
 }
 
 void crash(const char* s);
+
+namespace {
+
+// A detector's block size: its own prefix_fourier_blocksize, or else the
+// config-wide one, or else (configs from before either existed) the default.
+int parseBlocksize(farfetchd::ConfigReader const& cfg, std::string prefix)
+{
+  int blocksize = cfg.getInt(prefix + "_fourier_blocksize").value_or(
+      cfg.getInt("fourier_blocksize").value_or(kDefaultFourierBlocksize));
+  if (!isSupportedBlocksize(blocksize))
+    crash(("config has an unsupported " + prefix + " block size").c_str());
+  return blocksize;
+}
+
+// A detector's hop: its own prefix_fourier_hop, or else (no overlap) its
+// block size.
+int parseHop(farfetchd::ConfigReader const& cfg, std::string prefix, int blocksize)
+{
+  int hop = cfg.getInt(prefix + "_fourier_hop").value_or(blocksize);
+  if (!isSupportedHop(hop, blocksize))
+    crash(("config has an unsupported " + prefix + " hop").c_str());
+  return hop;
+}
+
+} // namespace
+
 char g_athene_url[512];
 char g_whisper_url[512];
 Config::Config(farfetchd::ConfigReader const& cfg) : blow(cfg), cat(cfg), hum(cfg)
 {
+  // (Configs from before this was configurable were all trained at the default).
+  fourier_blocksize = cfg.getInt("fourier_blocksize").value_or(kDefaultFourierBlocksize);
+  if (!isSupportedBlocksize(fourier_blocksize))
+    crash("config has an unsupported fourier_blocksize");
   athene_url = cfg.getString("athene_url").value_or("none");
   if (athene_url.size() > 511)
     crash("athene_url longer than 511 chars");
@@ -67,7 +97,9 @@ std::string Config::toString() const
         << "blow_o7_on_thresh: " << blow.o7_on_thresh << "\n"
         << "blow_o7_off_thresh: " << blow.o7_off_thresh << "\n"
         << "blow_lookback_blocks: " << blow.lookback_blocks << "\n"
-        << "blow_scale: " << blow.scale << "\n";
+        << "blow_scale: " << blow.scale << "\n"
+        << "blow_fourier_blocksize: " << blow.fourier_blocksize << "\n"
+        << "blow_fourier_hop: " << blow.fourier_hop << "\n";
   }
   if (cat.enabled)
   {
@@ -76,7 +108,9 @@ std::string Config::toString() const
         << "cat_o7_on_thresh: " << cat.o7_on_thresh << "\n"
         << "cat_o1_limit: " << cat.o1_limit << "\n"
         << "cat_use_limit: " << (cat.use_limit ? "true" : "false") << "\n"
-        << "cat_scale: " << cat.scale << "\n";
+        << "cat_scale: " << cat.scale << "\n"
+        << "cat_fourier_blocksize: " << cat.fourier_blocksize << "\n"
+        << "cat_fourier_hop: " << cat.fourier_hop << "\n";
   }
   if (hum.enabled)
   {
@@ -86,8 +120,12 @@ std::string Config::toString() const
         << "hum_o1_off_thresh: " << hum.o1_off_thresh << "\n"
         << "hum_o6_limit: " << hum.o6_limit << "\n"
         << "hum_ewma_alpha: " << hum.ewma_alpha << "\n"
-        << "hum_scale: " << hum.scale << "\n";
+        << "hum_scale: " << hum.scale << "\n"
+        << "hum_scroll: " << (hum.scroll ? "true" : "false") << "\n"
+        << "hum_fourier_blocksize: " << hum.fourier_blocksize << "\n"
+        << "hum_fourier_hop: " << hum.fourier_hop << "\n";
   }
+  sts << "fourier_blocksize: " << fourier_blocksize << "\n";
   sts << "whisper_url: " << whisper_url << "\n";
   sts << "athene_url: " << athene_url << "\n";
   return sts.str();
@@ -102,6 +140,8 @@ BlowConfig::BlowConfig(farfetchd::ConfigReader const& cfg)
   o7_off_thresh = cfg.getDouble("blow_o7_off_thresh").value_or(-1);
   lookback_blocks = cfg.getInt("blow_lookback_blocks").value_or(-1);
   scale = cfg.getDouble("blow_scale").value_or(-1);
+  fourier_blocksize = parseBlocksize(cfg, "blow");
+  fourier_hop = parseHop(cfg, "blow", fourier_blocksize);
 
   enabled = (action_on != Action::NoAction && action_off != Action::NoAction &&
              o1_on_thresh >= 0 && o7_on_thresh >= 0 && o7_off_thresh >= 0 &&
@@ -116,6 +156,8 @@ CatConfig::CatConfig(farfetchd::ConfigReader const& cfg)
   o1_limit = cfg.getDouble("cat_o1_limit").value_or(-1);
   use_limit = (cfg.getString("cat_use_limit").value_or("false") == "true");
   scale = cfg.getDouble("cat_scale").value_or(-1);
+  fourier_blocksize = parseBlocksize(cfg, "cat");
+  fourier_hop = parseHop(cfg, "cat", fourier_blocksize);
 
   enabled = (action_on != Action::NoAction && o7_on_thresh >= 0 && o1_limit >= 0 && scale >= 0);
 }
@@ -129,6 +171,9 @@ HumConfig::HumConfig(farfetchd::ConfigReader const& cfg)
   o6_limit = cfg.getDouble("hum_o6_limit").value_or(-1);
   ewma_alpha = cfg.getDouble("hum_ewma_alpha").value_or(-1);
   scale = cfg.getDouble("hum_scale").value_or(-1);
+  scroll = (cfg.getString("hum_scroll").value_or("false") == "true");
+  fourier_blocksize = parseBlocksize(cfg, "hum");
+  fourier_hop = parseHop(cfg, "hum", fourier_blocksize);
 
   enabled = (action_on != Action::NoAction &&
              o1_on_thresh >= 0 && o1_off_thresh >= 0 && o6_limit >= 0 &&
@@ -294,6 +339,14 @@ std::optional<Config> readConfig(std::string config_name)
   return Config(reader);
 }
 
+void keepHandWrittenSettings(Config* config, std::string config_name)
+{
+  farfetchd::ConfigReader reader;
+  if (!reader.parseFile(getAndEnsureConfigDir() + config_name + ".clickitongue"))
+    return;
+  config->hum.scroll = (reader.getString("hum_scroll").value_or("false") == "true");
+}
+
 bool writeConfig(Config config, std::string config_name,
                  std::string* attempted_filepath)
 {
@@ -25,6 +25,8 @@ struct BlowConfig
   double o7_off_thresh;
   int lookback_blocks;
   double scale;
+  int fourier_blocksize = kDefaultFourierBlocksize; // see Detector::blocksize()
+  int fourier_hop = kDefaultFourierBlocksize; // see Detector::hop()
 };
 
 struct CatConfig
@@ -39,6 +41,8 @@ struct CatConfig
   double o1_limit;
   bool use_limit;
   double scale;
+  int fourier_blocksize = kDefaultFourierBlocksize; // see Detector::blocksize()
+  int fourier_hop = kDefaultFourierBlocksize; // see Detector::hop()
 };
 
 struct HumConfig
@@ -54,6 +58,12 @@ struct HumConfig
   double o6_limit;
   double ewma_alpha;
   double scale;
+  // Scroll (by sliding the hum's pitch up or down) rather than clicking. Not
+  // set by training; write hum_scroll: true into the config file to use.
+  // (Retraining keeps it; see keepHandWrittenSettings()).
+  bool scroll = false;
+  int fourier_blocksize = kDefaultFourierBlocksize; // see Detector::blocksize()
+  int fourier_hop = kDefaultFourierBlocksize; // see Detector::hop()
 };
 
 struct Config
@@ -65,12 +75,20 @@ struct Config
   BlowConfig blow;
   CatConfig cat;
   HumConfig hum;
+  // The block size training defaulted to. Each detector has its own (which
+  // its block-count parameters only mean the same thing at).
+  int fourier_blocksize = kDefaultFourierBlocksize;
   std::string whisper_url;
   std::string athene_url;
 };
 
+std::string actionString(Action action);
+
 // Returns nullopt if it fails to read file.
 std::optional<Config> readConfig(std::string config_name);
+// Copies into config, from the existing config_name file (if any), the
+// settings training doesn't produce: currently just hum_scroll.
+void keepHandWrittenSettings(Config* config, std::string config_name);
 // Returns true if all is well, false if it fails to write the file or if it
 // fails in its attempt to immediately read+parse what was just written.
 // attempted_filepath will be filled with the destination filepath.
@@ -38,13 +38,47 @@ constexpr float kSilentSample = 0.0f;
 
 // Batch size of frames (i.e. pairs of samples if g_num_channels is 2) to feed
 // into each Fourier transform. This is sort of the "master granularity" of
-// all of our DSP logic; we do decision-making exactly every [this many frames].
-constexpr int kFourierBlocksize = 256; // must be 128, 256, 512, or 1024
+// all of our DSP logic; we do decision-making exactly every [this many frames]
+// (unless a smaller hop is set; see below).
+// Chosen at runtime (g_fourier_blocksize, remembered in the config) from
+// kSupportedBlocksizes: smaller blocks decide sooner, larger ones resolve
+// frequency more finely. Band powers are normalized to what a
+// kDefaultFourierBlocksize block would give (see spectrum_pipeline.h).
+constexpr int kDefaultFourierBlocksize = 256;
+constexpr int kSupportedBlocksizes[] = {128, 256, 512, 1024};
+constexpr int kMaxFourierBlocksize = 1024;
+constexpr bool isSupportedBlocksize(int blocksize)
+{
+  for (int supported : kSupportedBlocksizes)
+    if (blocksize == supported)
+      return true;
+  return false;
+}
+
+// Decisions can also come more often than once per block: every hop frames
+// (g_fourier_hop), each from the block of the last g_fourier_blocksize frames
+// (Hann windowed, when they overlap). The hop is a power of 2, at least
+// kMinFourierHop, and at most the block size; usually it's equal to it.
+constexpr int kMinFourierHop = 32;
+constexpr bool isSupportedHop(int hop, int blocksize)
+{
+  return hop >= kMinFourierHop && hop <= blocksize && (hop & (hop - 1)) == 0;
+}
+
+// Durations that the DSP logic counts in blocks are defined in milliseconds,
+// and converted to whatever hop is in use: the nearest whole number of hops,
+// but at least 1.
+constexpr int hopsIn(double ms, int hop)
+{
+  const int hops = (int)(ms * kFramesPerSec / (1000.0 * hop) + 0.5);
+  return hops > 1 ? hops : 1;
+}
 
-constexpr int kNumFourierBins = kFourierBlocksize/2 + 1;
+// (The --mode=equalizer etc. printouts always use kDefaultFourierBlocksize).
+constexpr int kNumFourierBins = kDefaultFourierBlocksize/2 + 1;
 
 // In Hz, the difference between two adjacent bin centers.
-constexpr double kBinWidth = kNyquist / (kFourierBlocksize / 2.0 + 1.0);
+constexpr double kBinWidth = kNyquist / (kDefaultFourierBlocksize / 2.0 + 1.0);
 
 using Sample = float;
 
@@ -59,5 +93,7 @@ enum class Action
 constexpr char kDefaultConfig[] = "default";
 
 extern int g_num_channels;
+extern int g_fourier_blocksize;
+extern int g_fourier_hop;
 
 #endif // CLICKITONGUE_CONSTANTS_H_
@@ -1,26 +1,28 @@
 #include "detector.h"
 
-constexpr int kInterTransitionBlocks = 3;
-
 Detector::Detector(Action action_on, Action action_off,
-                   BlockingQueue<Action>* action_queue,
+                   ActionRing* action_queue,
                    std::vector<int>* cur_frame_dest)
   : action_on_(action_on), action_off_(action_off),
-    action_queue_(action_queue), cur_frame_dest_(cur_frame_dest) {}
+    action_queue_(action_queue), cur_frame_dest_(cur_frame_dest)
+{
+  Detector::resolutionChanged();
+}
 
 Detector::~Detector() {}
 
-void Detector::processFourierOutputBlock(const fftw_complex* freq_power)
+void Detector::processBlock(BandFeatures const& features, int64_t adc_nanos)
 {
-  cur_frame_ += kFourierBlocksize;
-  updateState(freq_power);
+  cur_frame_ += hop_;
+  cur_adc_nanos_ = adc_nanos;
+  updateState(features);
 
   if (!enabled_)
     return;
 
   if (on_)
   {
-    if (shouldTransitionOff() && blocks_since_last_transition_ >= kInterTransitionBlocks)
+    if (shouldTransitionOff() && blocks_since_last_transition_ >= inter_transition_blocks_)
     {
       on_ = false;
       kickoffAction(action_off_);
@@ -31,7 +33,7 @@ void Detector::processFourierOutputBlock(const fftw_complex* freq_power)
   {
     if (refrac_blocks_left_ > 0)
       refrac_blocks_left_--;
-    else if (shouldTransitionOn() && blocks_since_last_transition_ >= kInterTransitionBlocks)
+    else if (shouldTransitionOn() && blocks_since_last_transition_ >= inter_transition_blocks_)
     {
       on_ = true;
       kickoffAction(action_on_);
@@ -47,17 +49,31 @@ void Detector::processFourierOutputBlock(const fftw_complex* freq_power)
       target->resetEWMAs();
     }
   }
-  if (blocks_since_last_transition_ < kInterTransitionBlocks)
+  if (blocks_since_last_transition_ < inter_transition_blocks_)
     blocks_since_last_transition_++;
 }
 
 void Detector::kickoffAction(Action action)
 {
   blocks_since_last_transition_ = 0;
+  if (event_log_ && action != Action::NoAction)
+    event_log_->emplace_back(cur_frame_, action);
   if (action == Action::RecordCurFrame)
     cur_frame_dest_->push_back(cur_frame_);
   else if (action != Action::NoAction)
-    action_queue_->enqueue(action);
+  {
+    TimedAction timed{action, cur_adc_nanos_, latencyNowNanos()};
+    if (timed.adc_nanos != 0)
+      clickLatency()->adc_to_decision.record(timed.decision_nanos - timed.adc_nanos);
+    action_queue_->enqueue(timed);
+  }
+}
+
+void Detector::emitAction(Action action)
+{
+  if (event_log_)
+    event_log_->emplace_back(cur_frame_, action);
+  action_queue_->enqueue(TimedAction{action});
 }
 
 void Detector::beginRefractoryPeriod(int length_blocks)
@@ -65,7 +81,24 @@ void Detector::beginRefractoryPeriod(int length_blocks)
   refrac_blocks_left_ = length_blocks;
 }
 
+void Detector::setResolution(int blocksize, int hop)
+{
+  blocksize_ = blocksize;
+  hop_ = hop;
+  resolutionChanged();
+}
+
+void Detector::resolutionChanged()
+{
+  inter_transition_blocks_ = blocksIn(kInterTransitionMs);
+}
+
 void Detector::addInhibitionTarget(Detector* target)
 {
   inhibition_targets_.push_back(target);
 }
+
+void Detector::setEventLog(std::vector<std::pair<int, Action>>* log)
+{
+  event_log_ = log;
+}
@@ -1,24 +1,60 @@
 #ifndef CLICKITONGUE_DETECTOR_H_
 #define CLICKITONGUE_DETECTOR_H_
 
-#include "blocking_queue.h"
+#include <cmath>
+
+#include "action_ring.h"
+#include "band_features.h"
 #include "constants.h"
-#include "easy_fourier.h"
+#include "latency_tracker.h"
+
+// Minimum time between an on and off transition (either order).
+constexpr double kInterTransitionMs = 17;
+
+// Trained parameters that are inherently per-block (an EWMA's weight, a
+// number of blocks) are stored per kDefaultFourierBlocksize frames, and
+// converted to whatever hop a detector runs at with these.
+inline double ewmaAlphaAtHop(double alpha, int hop)
+{
+  if (hop == kDefaultFourierBlocksize)
+    return alpha; // (exactly)
+  return 1.0 - std::pow(1.0 - alpha, (double)hop / kDefaultFourierBlocksize);
+}
+inline int blocksAtHop(int default_blocks, int hop)
+{
+  return (default_blocks * kDefaultFourierBlocksize + hop / 2) / hop;
+}
 
 class Detector
 {
 public:
-  // IMPORTANT: although the type is fftw_complex, in fact freq_power[i][0] for
-  // each i is expected to be the squared magnitude (i.e. real^2 + imag_coeff^2)
-  // of the original complex number output at bin i.
-  // The imaginary coefficient (array index 1) is left untouched - although
-  // you're likely not at all interested in it.
-  void processFourierOutputBlock(const fftw_complex* freq_power);
+  // features: of the next block of audio, as computed by a SpectrumPipeline
+  // that has seen every preceding block of this stream.
+  // adc_nanos: when that block's first sample was captured, in
+  // latencyNowNanos() time (0 if unknown); stamped onto any resulting action.
+  void processBlock(BandFeatures const& features, int64_t adc_nanos = 0);
 
   // After calling foo.addInhibitionTarget(bar), foo will keep bar's refractory
   // countdown maxed out for as long as foo is in the on state.
   void addInhibitionTarget(Detector* target);
 
+  // From now on, every action (other than NoAction) this detector kicks off
+  // also gets appended to log, along with the frame index it happened at.
+  void setEventLog(std::vector<std::pair<int, Action>>* log);
+
+  // Whether this detector reads BandFeatures::pitch_hz, which the pipeline
+  // only computes if some detector does.
+  virtual bool wantsPitch() const { return false; }
+
+  // How many frames each of this detector's blocks is (the resolution of the
+  // spectra it gets fed; see FFTResultDistributor), and how many frames apart
+  // they are: a block is one processBlock() call, every hop() frames.
+  // g_fourier_blocksize and g_fourier_hop as of construction, unless set.
+  int blocksize() const { return blocksize_; }
+  int hop() const { return hop_; }
+  // Call before feeding any blocks.
+  void setResolution(int blocksize, int hop);
+
   Detector() = delete;
   virtual ~Detector();
 
@@ -26,25 +62,32 @@ public:
 
 protected:
   Detector(Action action_on, Action action_off,
-           BlockingQueue<Action>* action_queue,
+           ActionRing* action_queue,
            std::vector<int>* cur_frame_dest = nullptr);
 
-  // IMPORTANT: although the type is fftw_complex, in fact freq_power[i][0] for
-  // each i is expected to be the squared magnitude (i.e. real^2 + imag_coeff^2)
-  // of the original complex number output at bin i.
-  // The imaginary coefficient (array index 1) is left untouched - although
-  // you're likely not at all interested in it.
-  virtual void updateState(const fftw_complex* freq_power) = 0;
+  virtual void updateState(BandFeatures const& features) = 0;
 
   virtual bool shouldTransitionOn() = 0;
   virtual bool shouldTransitionOff() = 0;
 
-  // How long (in units of kFourierBlocksize) we must observe low energy after
-  // an event before being willing to declare an event of this type.
+  // How long (in blocks) we must observe low energy after an event before
+  // being willing to declare an event of this type.
   virtual int refracPeriodLengthBlocks() const = 0;
 
+  // About ms milliseconds, in blocks: see hopsIn().
+  int blocksIn(double ms) const { return hopsIn(ms, hop_); }
+  // Re-derives whatever is counted in blocks, for the current hop(). Called
+  // by setResolution(); subclasses should call it from their constructor too,
+  // and have theirs call their base's.
+  virtual void resolutionChanged();
+
   virtual void resetEWMAs() = 0;
 
+  // For actions that aren't on/off transitions, e.g. HumScrollDetector's
+  // scrolling while on. These aren't clicks, so they're left out of
+  // clickLatency().
+  void emitAction(Action action);
+
   bool on_ = false;
 
 private:
@@ -56,9 +99,14 @@ private:
   // ...and stopped.
   const Action action_off_;
 
-  BlockingQueue<Action>* action_queue_ = nullptr;
+  ActionRing* action_queue_ = nullptr;
+  int blocksize_ = g_fourier_blocksize;
+  int hop_ = g_fourier_hop;
+  int inter_transition_blocks_;
   int cur_frame_ = 0;
+  int64_t cur_adc_nanos_ = 0;
   std::vector<int>* cur_frame_dest_ = nullptr;
+  std::vector<std::pair<int, Action>>* event_log_ = nullptr;
   std::vector<Detector*> inhibition_targets_;
 
   int refrac_blocks_left_ = 0;
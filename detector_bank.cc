@@ -0,0 +1,315 @@
+#include "detector_bank.h"
+
+#include <algorithm>
+
+template<class Derived>
+void DetectorBank<Derived>::processBlock(BandFeatures const& features)
+{
+  Derived* self = static_cast<Derived*>(this);
+  self->updateStates(features);
+
+  // Mirrors Detector::processBlock(), with enabled_ always true and no
+  // inhibition targets.
+  for (int i = 0; i < numLanes(); i++)
+  {
+    if (on_[i])
+    {
+      if (self->shouldTransitionOff(i) &&
+          blocks_since_last_transition_[i] >= inter_transition_blocks_)
+      {
+        on_[i] = false;
+        blocks_since_last_transition_[i] = 0;
+        self->resetEWMAs(i);
+      }
+    }
+    else // off
+    {
+      if (refrac_blocks_left_[i] > 0)
+        refrac_blocks_left_[i]--;
+      else if (self->shouldTransitionOn(i) &&
+               blocks_since_last_transition_[i] >= inter_transition_blocks_)
+      {
+        on_[i] = true;
+        blocks_since_last_transition_[i] = 0;
+        events_[i]++;
+      }
+    }
+
+    if (on_[i])
+      refrac_blocks_left_[i] = refrac_blocks_;
+    if (blocks_since_last_transition_[i] < inter_transition_blocks_)
+      blocks_since_last_transition_[i]++;
+  }
+}
+
+template<class Derived>
+void DetectorBank<Derived>::addLaneCommon()
+{
+  on_.push_back(false);
+  refrac_blocks_left_.push_back(0);
+  blocks_since_last_transition_.push_back(0);
+  events_.push_back(0);
+}
+
+template<class Derived>
+void DetectorBank<Derived>::resetCommon()
+{
+  std::fill(on_.begin(), on_.end(), false);
+  std::fill(refrac_blocks_left_.begin(), refrac_blocks_left_.end(), 0);
+  std::fill(blocks_since_last_transition_.begin(),
+            blocks_since_last_transition_.end(), 0);
+  std::fill(events_.begin(), events_.end(), 0);
+}
+
+template class DetectorBank<BlowDetectorBank>;
+template class DetectorBank<CatDetectorBank>;
+template class DetectorBank<HumDetectorBank>;
+
+void BlowDetectorBank::addLane(double o1_on_thresh, double o7_on_thresh,
+                               double o7_off_thresh, int lookback_blocks,
+                               bool require_delay)
+{
+  addLaneCommon();
+  o1_on_thresh_.push_back(o1_on_thresh);
+  o7_on_thresh_.push_back(o7_on_thresh);
+  o7_off_thresh_.push_back(o7_off_thresh);
+  lookback_blocks_.push_back(blocksAtHop(lookback_blocks, hop_));
+  require_delay_.push_back(require_delay);
+
+  blocks_since_event_.push_back(0);
+  o1_elevated_thresh_.push_back(0);
+  o7_elevated_thresh_.push_back(0);
+  blocks_since_1above_.push_back(0);
+  blocks_since_7above_.push_back(0);
+  delay_blocks_left_.push_back(0);
+  deactivate_warmup_blocks_left_.push_back(0);
+  reset();
+}
+
+void BlowDetectorBank::reset()
+{
+  resetCommon();
+  std::fill(blocks_since_event_.begin(), blocks_since_event_.end(),
+            kForeverBlocksAgo);
+  std::fill(o1_elevated_thresh_.begin(), o1_elevated_thresh_.end(), 0);
+  std::fill(o7_elevated_thresh_.begin(), o7_elevated_thresh_.end(), 0);
+  std::fill(blocks_since_1above_.begin(), blocks_since_1above_.end(),
+            kForeverBlocksAgo);
+  std::fill(blocks_since_7above_.begin(), blocks_since_7above_.end(),
+            kForeverBlocksAgo);
+  std::fill(delay_blocks_left_.begin(), delay_blocks_left_.end(), -1);
+  std::fill(deactivate_warmup_blocks_left_.begin(),
+            deactivate_warmup_blocks_left_.end(), deactivate_warmup_blocks_);
+}
+
+void BlowDetectorBank::updateStates(BandFeatures const& features)
+{
+  o1_cur_ = features.octave[kBlowLowOctave];
+  o1_recent_max_ = features.recent_max[kBlowLowOctave];
+  o7_cur_ = features.octave[kBlowHighOctave];
+  o7_recent_max_ = features.recent_max[kBlowHighOctave];
+
+  const int n = numLanes();
+  for (int i = 0; i < n; i++)
+  {
+    double cur_o1_on_thresh = o1_on_thresh_[i];
+    double cur_o7_on_thresh = o7_on_thresh_[i];
+    if (blocks_since_event_[i] < elevated_thresh_blocks_)
+    {
+      double elevated_frac = ((double)elevated_thresh_blocks_ - blocks_since_event_[i]) /
+                             elevated_thresh_blocks_;
+      double standard_frac = 1.0 - elevated_frac;
+      cur_o1_on_thresh = standard_frac * o1_on_thresh_[i] + elevated_frac * o1_elevated_thresh_[i];
+      cur_o7_on_thresh = standard_frac * o7_on_thresh_[i] + elevated_frac * o7_elevated_thresh_[i];
+      blocks_since_event_[i]++;
+    }
+    blocks_since_1above_[i] = o1_cur_ > cur_o1_on_thresh
+        ? 0 : std::min(blocks_since_1above_[i] + 1, kForeverBlocksAgo);
+    blocks_since_7above_[i] = o7_cur_ > cur_o7_on_thresh
+        ? 0 : std::min(blocks_since_7above_[i] + 1, kForeverBlocksAgo);
+  }
+}
+
+void BlowDetectorBank::updateElevatedThreshs(int lane)
+{
+  blocks_since_event_[lane] = 0;
+  o1_elevated_thresh_[lane] = 0.9 * o1_recent_max_;
+  o7_elevated_thresh_[lane] = 0.9 * o7_recent_max_;
+}
+
+bool BlowDetectorBank::shouldTransitionOn(int lane)
+{
+  bool activated = (blocks_since_1above_[lane] <= lookback_blocks_[lane] &&
+                    blocks_since_7above_[lane] <= lookback_blocks_[lane]);
+  if (delay_blocks_left_[lane] < 0 && activated)
+    delay_blocks_left_[lane] = delay_blocks_;
+  if (delay_blocks_left_[lane] > 0 &&
+      (!require_delay_[lane] || --delay_blocks_left_[lane] == 0))
+  {
+    delay_blocks_left_[lane] = -1;
+    updateElevatedThreshs(lane);
+    return true;
+  }
+  return false;
+}
+
+bool BlowDetectorBank::shouldTransitionOff(int lane)
+{
+  if (!(o7_cur_ < o7_off_thresh_[lane]))
+  {
+    deactivate_warmup_blocks_left_[lane] = deactivate_warmup_blocks_;
+    return false;
+  }
+  if (--deactivate_warmup_blocks_left_[lane] <= 0)
+  {
+    deactivate_warmup_blocks_left_[lane] = deactivate_warmup_blocks_;
+    updateElevatedThreshs(lane);
+    return true;
+  }
+  return false;
+}
+
+void BlowDetectorBank::resetEWMAs(int lane)
+{
+  blocks_since_1above_[lane] = kForeverBlocksAgo;
+  blocks_since_7above_[lane] = kForeverBlocksAgo;
+  delay_blocks_left_[lane] = -1;
+  deactivate_warmup_blocks_left_[lane] = -1;
+  updateElevatedThreshs(lane);
+}
+
+void CatDetectorBank::addLane(double o7_on_thresh, double o1_limit, bool use_limit)
+{
+  addLaneCommon();
+  o7_on_thresh_.push_back(o7_on_thresh);
+  o1_limit_.push_back(o1_limit);
+  use_limit_.push_back(use_limit);
+
+  cur_o7_thresh_.push_back(0);
+  warmed_up_.push_back(false);
+  o1_cooldown_blocks_.push_back(0);
+  reset();
+}
+
+void CatDetectorBank::reset()
+{
+  resetCommon();
+  cur_o7_thresh_ = o7_on_thresh_;
+  std::fill(warmed_up_.begin(), warmed_up_.end(), false);
+  std::fill(o1_cooldown_blocks_.begin(), o1_cooldown_blocks_.end(), 0);
+}
+
+void CatDetectorBank::updateStates(BandFeatures const& features)
+{
+  const double o1_cur = features.octave[kCatLowOctave];
+  o7_cur_ = features.octave[kCatHighOctave];
+
+  const int n = numLanes();
+  for (int i = 0; i < n; i++)
+  {
+    if (!use_limit_[i])
+      continue;
+    if (o1_cur > o1_limit_[i])
+    {
+      o1_cooldown_blocks_[i] = o1_cooldown_length_blocks_;
+      cur_o7_thresh_[i] = o7_on_thresh_[i] + kCatO1Boost * o7_on_thresh_[i];
+      warmed_up_[i] = false;
+    }
+    else if (o1_cooldown_blocks_[i] > 0)
+    {
+      o1_cooldown_blocks_[i]--;
+      cur_o7_thresh_[i] -= (kCatO1Boost / o1_cooldown_length_blocks_) * o7_on_thresh_[i];
+    }
+  }
+}
+
+bool CatDetectorBank::shouldTransitionOn(int lane)
+{
+  bool satisfied = o7_cur_ > cur_o7_thresh_[lane];
+  if (!use_limit_[lane])
+    return satisfied;
+
+  if (warmed_up_[lane])
+  {
+    warmed_up_[lane] = false;
+    return satisfied;
+  }
+  if (satisfied)
+    warmed_up_[lane] = true;
+  return false;
+}
+
+bool CatDetectorBank::shouldTransitionOff(int lane)
+{
+  return o7_cur_ < o7_on_thresh_[lane];
+}
+
+void HumDetectorBank::addLane(double o1_on_thresh, double o1_off_thresh,
+                              double o6_limit, double ewma_alpha,
+                              bool require_delay)
+{
+  addLaneCommon();
+  o1_on_thresh_.push_back(o1_on_thresh);
+  o1_off_thresh_.push_back(o1_off_thresh);
+  o6_limit_.push_back(o6_limit);
+  ewma_alpha_.push_back(ewmaAlphaAtHop(ewma_alpha, hop_));
+  one_minus_ewma_alpha_.push_back(1.0 - ewma_alpha_.back());
+  require_delay_.push_back(require_delay);
+
+  o1_ewma_.push_back(0);
+  o6_ewma_.push_back(0);
+  delay_blocks_left_.push_back(-1);
+  reset();
+}
+
+void HumDetectorBank::reset()
+{
+  resetCommon();
+  std::fill(o1_ewma_.begin(), o1_ewma_.end(), 0);
+  std::fill(o6_ewma_.begin(), o6_ewma_.end(), 0);
+  std::fill(delay_blocks_left_.begin(), delay_blocks_left_.end(), -1);
+}
+
+void HumDetectorBank::updateStates(BandFeatures const& features)
+{
+  const double o1 = features.octave[kHumLowOctave];
+  const double o6 = features.octave[kHumHighOctave];
+
+  const int n = numLanes();
+  double* o1_ewma = o1_ewma_.data();
+  double* o6_ewma = o6_ewma_.data();
+  const double* alpha = ewma_alpha_.data();
+  const double* one_minus_alpha = one_minus_ewma_alpha_.data();
+  for (int i = 0; i < n; i++)
+  {
+    o1_ewma[i] = o1_ewma[i] * one_minus_alpha[i] + o1 * alpha[i];
+    o6_ewma[i] = o6_ewma[i] * one_minus_alpha[i] + o6 * alpha[i];
+  }
+}
+
+bool HumDetectorBank::shouldTransitionOn(int lane)
+{
+  if (delay_blocks_left_[lane] < 0 && o1_ewma_[lane] > o1_on_thresh_[lane] &&
+      o6_ewma_[lane] < o6_limit_[lane])
+  {
+    delay_blocks_left_[lane] = delay_blocks_;
+  }
+  if (delay_blocks_left_[lane] > 0 &&
+      (!require_delay_[lane] || --delay_blocks_left_[lane] == 0))
+  {
+    delay_blocks_left_[lane] = -1;
+    return true;
+  }
+  return false;
+}
+
+bool HumDetectorBank::shouldTransitionOff(int lane)
+{
+  return o1_ewma_[lane] < o1_off_thresh_[lane];
+}
+
+void HumDetectorBank::resetEWMAs(int lane)
+{
+  o1_ewma_[lane] = 0;
+  delay_blocks_left_[lane] = -1;
+}
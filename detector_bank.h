@@ -0,0 +1,164 @@
+#ifndef CLICKITONGUE_DETECTOR_BANK_H_
+#define CLICKITONGUE_DETECTOR_BANK_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "band_features.h"
+#include "blow_detector.h"
+#include "cat_detector.h"
+#include "hum_detector.h"
+
+// For training: many independent detectors of one type ("lanes"), each with
+// its own parameters, stepped through the same BandFeatures stream in
+// lockstep. Lane i behaves exactly like a lone Detector of that type
+// constructed with lane i's parameters (and the same hop: g_fourier_hop, as of
+// the bank's construction), except that rather than kicking off actions it
+// just counts its on-transitions.
+//
+// State is stored structure-of-arrays: each block's features are read once,
+// and applied to every lane by tight loops over contiguous per-lane arrays
+// (the arithmetic parts of which the compiler vectorizes across lanes).
+//
+// Derived must provide:
+//   void updateStates(BandFeatures const& features); // (all lanes)
+//   bool shouldTransitionOn(int lane);
+//   bool shouldTransitionOff(int lane);
+//   void resetEWMAs(int lane);
+//   static constexpr double kRefracMs;
+template<class Derived>
+class DetectorBank
+{
+public:
+  int numLanes() const { return on_.size(); }
+
+  // Like Detector::processBlock(), for every lane.
+  void processBlock(BandFeatures const& features);
+
+  // How many times the lane has transitioned to on since the last reset.
+  int events(int lane) const { return events_[lane]; }
+
+protected:
+  const int hop_ = g_fourier_hop;
+  int blocksIn(double ms) const { return hopsIn(ms, hop_); }
+
+  void addLaneCommon();
+  // Puts every lane's Detector state back to how it was right after
+  // construction.
+  void resetCommon();
+
+private:
+  const int inter_transition_blocks_ = blocksIn(kInterTransitionMs);
+  const int refrac_blocks_ = blocksIn(Derived::kRefracMs);
+
+  std::vector<uint8_t> on_;
+  std::vector<int> refrac_blocks_left_;
+  std::vector<int> blocks_since_last_transition_;
+  std::vector<int> events_;
+};
+
+class BlowDetectorBank : public DetectorBank<BlowDetectorBank>
+{
+public:
+  static constexpr double kRefracMs = kBlowRefracMs;
+
+  void addLane(double o1_on_thresh, double o7_on_thresh, double o7_off_thresh,
+               int lookback_blocks, bool require_delay);
+  void reset();
+
+  void updateStates(BandFeatures const& features);
+  bool shouldTransitionOn(int lane);
+  bool shouldTransitionOff(int lane);
+  void resetEWMAs(int lane);
+
+private:
+  void updateElevatedThreshs(int lane);
+
+  // Per-lane parameters; see BlowDetector.
+  std::vector<double> o1_on_thresh_;
+  std::vector<double> o7_on_thresh_;
+  std::vector<double> o7_off_thresh_;
+  std::vector<int> lookback_blocks_; // (converted to hop_)
+  std::vector<uint8_t> require_delay_;
+
+  const int delay_blocks_ = blocksIn(kBlowDelayMs);
+  const int deactivate_warmup_blocks_ = blocksIn(kBlowDeactivateWarmupMs);
+  const int elevated_thresh_blocks_ = blocksIn(kBlowElevatedThreshMs);
+
+  // The current block's features; the same for all lanes.
+  double o1_cur_ = 0;
+  double o7_cur_ = 0;
+  double o1_recent_max_ = 0;
+  double o7_recent_max_ = 0;
+
+  // Per-lane state; see BlowDetector.
+  std::vector<int> blocks_since_event_;
+  std::vector<double> o1_elevated_thresh_;
+  std::vector<double> o7_elevated_thresh_;
+  std::vector<int> blocks_since_1above_;
+  std::vector<int> blocks_since_7above_;
+  std::vector<int> delay_blocks_left_;
+  std::vector<int> deactivate_warmup_blocks_left_;
+};
+
+class CatDetectorBank : public DetectorBank<CatDetectorBank>
+{
+public:
+  static constexpr double kRefracMs = kCatRefracMs;
+
+  void addLane(double o7_on_thresh, double o1_limit, bool use_limit);
+  void reset();
+
+  void updateStates(BandFeatures const& features);
+  bool shouldTransitionOn(int lane);
+  bool shouldTransitionOff(int lane);
+  void resetEWMAs(int lane) {}
+
+private:
+  // Per-lane parameters; see CatDetector.
+  std::vector<double> o7_on_thresh_;
+  std::vector<double> o1_limit_;
+  std::vector<uint8_t> use_limit_;
+
+  const int o1_cooldown_length_blocks_ = blocksIn(kCatO1CooldownMs);
+
+  double o7_cur_ = 0;
+
+  // Per-lane state; see CatDetector.
+  std::vector<double> cur_o7_thresh_;
+  std::vector<uint8_t> warmed_up_;
+  std::vector<int> o1_cooldown_blocks_;
+};
+
+class HumDetectorBank : public DetectorBank<HumDetectorBank>
+{
+public:
+  static constexpr double kRefracMs = kHumRefracMs;
+
+  void addLane(double o1_on_thresh, double o1_off_thresh, double o6_limit,
+               double ewma_alpha, bool require_delay);
+  void reset();
+
+  void updateStates(BandFeatures const& features);
+  bool shouldTransitionOn(int lane);
+  bool shouldTransitionOff(int lane);
+  void resetEWMAs(int lane);
+
+private:
+  // Per-lane parameters; see HumDetector.
+  std::vector<double> o1_on_thresh_;
+  std::vector<double> o1_off_thresh_;
+  std::vector<double> o6_limit_;
+  std::vector<double> ewma_alpha_; // (converted to hop_)
+  std::vector<double> one_minus_ewma_alpha_;
+  std::vector<uint8_t> require_delay_;
+
+  const int delay_blocks_ = blocksIn(kHumDelayMs);
+
+  // Per-lane state; see HumDetector.
+  std::vector<double> o1_ewma_;
+  std::vector<double> o6_ewma_;
+  std::vector<int> delay_blocks_left_;
+};
+
+#endif // CLICKITONGUE_DETECTOR_BANK_H_
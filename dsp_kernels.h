@@ -0,0 +1,209 @@
+#ifndef CLICKITONGUE_DSP_KERNELS_H_
+#define CLICKITONGUE_DSP_KERNELS_H_
+
+// Small hot loops on the per-block audio path, vectorized where the target
+// supports it (AVX2 if built with e.g. -mavx2, else SSE2 on any x86-64, NEON
+// on ARM), with a plain scalar loop otherwise. The vector paths only exist for
+// the single precision pipeline; a CLICKITONGUE_FFT_DOUBLE build always uses
+// the scalar loops.
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "constants.h"
+#include "easy_fourier.h"
+
+#if !defined(CLICKITONGUE_FFT_DOUBLE)
+#if defined(__AVX2__)
+#define CLICKITONGUE_DSP_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#define CLICKITONGUE_DSP_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#define CLICKITONGUE_DSP_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+// out[i] = (frames[2i] + frames[2i+1]) / 2, for i in [0, num_frames).
+template<class Out> // FourierReal, or Sample for mono recording storage
+inline void downmixStereo(const Sample* frames, Out* out, int num_frames)
+{
+  int i = 0;
+  if constexpr (std::is_same<Out, float>::value)
+  {
+#if defined(CLICKITONGUE_DSP_AVX2)
+    const __m256 half = _mm256_set1_ps(0.5f);
+    for (; i + 8 <= num_frames; i += 8)
+    {
+      __m256 a = _mm256_loadu_ps(frames + 2*i);     // L0 R0 L1 R1 | L2 R2 L3 R3
+      __m256 b = _mm256_loadu_ps(frames + 2*i + 8); // L4 R4 L5 R5 | L6 R6 L7 R7
+      // hadd works within 128-bit lanes: L0+R0 L1+R1 L4+R4 L5+R5 | L2+R2 ...
+      __m256 sums = _mm256_hadd_ps(a, b);
+      sums = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(sums), 0xD8));
+      _mm256_storeu_ps(out + i, _mm256_mul_ps(sums, half));
+    }
+#elif defined(CLICKITONGUE_DSP_SSE2)
+    const __m128 half = _mm_set1_ps(0.5f);
+    for (; i + 4 <= num_frames; i += 4)
+    {
+      __m128 a = _mm_loadu_ps(frames + 2*i);     // L0 R0 L1 R1
+      __m128 b = _mm_loadu_ps(frames + 2*i + 4); // L2 R2 L3 R3
+      __m128 lefts = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+      __m128 rights = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+      _mm_storeu_ps(out + i, _mm_mul_ps(_mm_add_ps(lefts, rights), half));
+    }
+#elif defined(CLICKITONGUE_DSP_NEON)
+    const float32x4_t half = vdupq_n_f32(0.5f);
+    for (; i + 4 <= num_frames; i += 4)
+    {
+      float32x4x2_t lr = vld2q_f32(frames + 2*i); // deinterleaves for us
+      vst1q_f32(out + i, vmulq_f32(vaddq_f32(lr.val[0], lr.val[1]), half));
+    }
+#endif
+  }
+  for (const Sample* lr = frames + 2*i; i < num_frames; i++, lr += 2)
+    out[i] = (lr[0] + lr[1]) / (Out)2;
+}
+
+inline void copyMono(const Sample* frames, FourierReal* out, int num_frames)
+{
+  for (int i = 0; i < num_frames; i++)
+    out[i] = frames[i];
+}
+
+// bins[i][0] = scale * (bins[i][0]^2 + bins[i][1]^2), in a single pass.
+// bins[i][1] is left untouched.
+inline void scaledPowerInPlace(FourierComplex* bins, int num_bins, double scale)
+{
+  int i = 0;
+#if defined(CLICKITONGUE_DSP_AVX2)
+  float* flat = &bins[0][0];
+  const __m256 scl = _mm256_set1_ps((float)scale);
+  const __m256 real_slots = _mm256_castsi256_ps(
+      _mm256_set_epi32(0, -1, 0, -1, 0, -1, 0, -1));
+  for (; i + 4 <= num_bins; i += 4)
+  {
+    __m256 v = _mm256_loadu_ps(flat + 2*i);            // re0 im0 re1 im1 ...
+    __m256 sq = _mm256_mul_ps(v, v);
+    __m256 swapped = _mm256_permute_ps(sq, _MM_SHUFFLE(2, 3, 0, 1));
+    __m256 power = _mm256_mul_ps(_mm256_add_ps(sq, swapped), scl);
+    _mm256_storeu_ps(flat + 2*i, _mm256_blendv_ps(v, power, real_slots));
+  }
+#elif defined(CLICKITONGUE_DSP_SSE2)
+  float* flat = &bins[0][0];
+  const __m128 scl = _mm_set1_ps((float)scale);
+  const __m128 real_slots = _mm_castsi128_ps(_mm_set_epi32(0, -1, 0, -1));
+  for (; i + 2 <= num_bins; i += 2)
+  {
+    __m128 v = _mm_loadu_ps(flat + 2*i);               // re0 im0 re1 im1
+    __m128 sq = _mm_mul_ps(v, v);
+    __m128 swapped = _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 power = _mm_mul_ps(_mm_add_ps(sq, swapped), scl);
+    _mm_storeu_ps(flat + 2*i, _mm_or_ps(_mm_and_ps(real_slots, power),
+                                        _mm_andnot_ps(real_slots, v)));
+  }
+#elif defined(CLICKITONGUE_DSP_NEON)
+  float* flat = &bins[0][0];
+  for (; i + 4 <= num_bins; i += 4)
+  {
+    float32x4x2_t ri = vld2q_f32(flat + 2*i); // val[0]: reals, val[1]: imags
+    float32x4_t power = vmlaq_f32(vmulq_f32(ri.val[0], ri.val[0]),
+                                  ri.val[1], ri.val[1]);
+    ri.val[0] = vmulq_n_f32(power, (float)scale);
+    vst2q_f32(flat + 2*i, ri);
+  }
+#endif
+  for (; i < num_bins; i++)
+    bins[i][0] = scale * (bins[i][0]*bins[i][0] + bins[i][1]*bins[i][1]);
+}
+
+// Sum of bins[i][0] for i in [begin, end).
+inline double sumPowers(const FourierComplex* bins, int begin, int end)
+{
+  int i = begin;
+  double total = 0;
+#if defined(CLICKITONGUE_DSP_AVX2)
+  const float* flat = &bins[0][0];
+  __m256 acc = _mm256_setzero_ps();
+  for (; i + 4 <= end; i += 4)
+    acc = _mm256_add_ps(acc, _mm256_loadu_ps(flat + 2*i));
+  alignas(32) float lanes[8];
+  _mm256_store_ps(lanes, acc);
+  total = (double)lanes[0] + lanes[2] + lanes[4] + lanes[6]; // (odd: imag)
+#elif defined(CLICKITONGUE_DSP_SSE2)
+  const float* flat = &bins[0][0];
+  __m128 acc = _mm_setzero_ps();
+  for (; i + 2 <= end; i += 2)
+    acc = _mm_add_ps(acc, _mm_loadu_ps(flat + 2*i));
+  alignas(16) float lanes[4];
+  _mm_store_ps(lanes, acc);
+  total = (double)lanes[0] + lanes[2]; // (lanes 1 and 3 are imaginary parts)
+#elif defined(CLICKITONGUE_DSP_NEON)
+  const float* flat = &bins[0][0];
+  float32x4_t acc = vdupq_n_f32(0);
+  for (; i + 4 <= end; i += 4)
+    acc = vaddq_f32(acc, vld2q_f32(flat + 2*i).val[0]);
+  float32x2_t pair = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+  total = vget_lane_f32(vpadd_f32(pair, pair), 0);
+#endif
+  for (; i < end; i++)
+    total += bins[i][0];
+  return total;
+}
+
+// Decodes the raw big-endian uint16 PCM that AudioRecording's files hold:
+// out[i] = (v - 32768) / 32767, v being bytes[2i..2i+1] read big-endian. (Not
+// on the per-block path, but training loads several MB of it every run). The
+// vector paths divide in single precision, which for these operands rounds to
+// exactly the same floats as the scalar loop's double math.
+inline void decodeBigEndianPCM(const uint8_t* bytes, Sample* out, size_t num_samples)
+{
+  size_t i = 0;
+#if defined(CLICKITONGUE_DSP_AVX2)
+  const __m256 offset = _mm256_set1_ps(32768.0f);
+  const __m256 range = _mm256_set1_ps(32767.0f);
+  for (; i + 16 <= num_samples; i += 16)
+  {
+    __m256i be = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bytes + 2*i));
+    __m256i v = _mm256_or_si256(_mm256_slli_epi16(be, 8), _mm256_srli_epi16(be, 8));
+    __m256 lo = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(v)));
+    __m256 hi = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(v, 1)));
+    _mm256_storeu_ps(out + i, _mm256_div_ps(_mm256_sub_ps(lo, offset), range));
+    _mm256_storeu_ps(out + i + 8, _mm256_div_ps(_mm256_sub_ps(hi, offset), range));
+  }
+#elif defined(CLICKITONGUE_DSP_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128 offset = _mm_set1_ps(32768.0f);
+  const __m128 range = _mm_set1_ps(32767.0f);
+  for (; i + 8 <= num_samples; i += 8)
+  {
+    __m128i be = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + 2*i));
+    __m128i v = _mm_or_si128(_mm_slli_epi16(be, 8), _mm_srli_epi16(be, 8));
+    __m128 lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero));
+    __m128 hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero));
+    _mm_storeu_ps(out + i, _mm_div_ps(_mm_sub_ps(lo, offset), range));
+    _mm_storeu_ps(out + i + 4, _mm_div_ps(_mm_sub_ps(hi, offset), range));
+  }
+#elif defined(CLICKITONGUE_DSP_NEON) && defined(__aarch64__) && !defined(__ARM_BIG_ENDIAN)
+  const float32x4_t offset = vdupq_n_f32(32768.0f);
+  const float32x4_t range = vdupq_n_f32(32767.0f);
+  for (; i + 8 <= num_samples; i += 8)
+  {
+    uint16x8_t v = vreinterpretq_u16_u8(vrev16q_u8(vld1q_u8(bytes + 2*i)));
+    float32x4_t lo = vcvtq_f32_u32(vmovl_u16(vget_low_u16(v)));
+    float32x4_t hi = vcvtq_f32_u32(vmovl_u16(vget_high_u16(v)));
+    vst1q_f32(out + i, vdivq_f32(vsubq_f32(lo, offset), range));
+    vst1q_f32(out + i + 4, vdivq_f32(vsubq_f32(hi, offset), range));
+  }
+#endif
+  for (; i < num_samples; i++)
+  {
+    uint16_t v = (uint16_t)((bytes[2*i] << 8) | bytes[2*i + 1]);
+    out[i] = (Sample)((v - 32768.0) / 32767.0);
+  }
+}
+
+#endif // CLICKITONGUE_DSP_KERNELS_H_
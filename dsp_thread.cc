@@ -0,0 +1,107 @@
+#include "dsp_thread.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "interaction.h"
+#include "realtime_check.h"
+#include "telemetry.h"
+
+#ifdef CLICKITONGUE_LINUX
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+void crash(const char* s);
+
+DspThread::DspThread(FFTResultDistributor* distributor, int max_queue_blocks)
+  : distributor_(distributor),
+    max_queue_blocks_(std::clamp(max_queue_blocks, 1, kMaxQueueBlocks))
+{
+  if (g_num_channels > kMaxInputChannels)
+    crash("DspThread supports at most 2 input channels");
+  thread_ = std::thread(&DspThread::run, this);
+}
+
+DspThread::~DspThread()
+{
+  stop_.store(true, std::memory_order_release);
+  wakeup_.wake();
+  thread_.join();
+}
+
+void DspThread::enqueueBlock(const Sample* samples, int num_frames,
+                             int64_t adc_nanos)
+{
+  AudioBlock* block = ring_.size() < max_queue_blocks_ ? ring_.pushSlot() : nullptr;
+  if (!block)
+  {
+    telemetry()->countDspOverflow();
+    return;
+  }
+  // (processAudio() will complain about any num_frames but its inputBlocksize()).
+  memcpy(block->samples, samples,
+         std::min(num_frames, kMaxFourierBlocksize) * g_num_channels * sizeof(Sample));
+  block->num_frames = num_frames;
+  block->adc_nanos = adc_nanos;
+  ring_.commitPush();
+  wakeup_.wake();
+}
+
+void DspThread::heartbeatWithoutInput()
+{
+  distributor_->heartbeat_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void DspThread::run()
+{
+#ifdef CLICKITONGUE_LINUX
+  // Just below the top real-time priority (left for e.g. the audio server),
+  // and on the last core, away from where interrupts usually get handled.
+  sched_param param{};
+  param.sched_priority = sched_get_priority_max(SCHED_FIFO) - 1;
+  if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0)
+    PRINTERR(stderr, "DSP thread: couldn't get SCHED_FIFO; running at normal priority\n");
+  const int num_cores = std::thread::hardware_concurrency();
+  if (num_cores > 1)
+  {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(num_cores - 1, &cpus);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0)
+      PRINTERR(stderr, "DSP thread: couldn't pin to core %d\n", num_cores - 1);
+  }
+#endif
+  while (true)
+  {
+    if (AudioBlock* block = ring_.frontSlot())
+    {
+      RealtimeScope realtime;
+      distributor_->processAudio(block->samples, block->num_frames,
+                                 block->adc_nanos);
+      ring_.commitPop();
+      continue;
+    }
+    if (stop_.load(std::memory_order_acquire))
+      return;
+    wakeup_.wait();
+  }
+}
+
+int dspThreadCallback(const void* input, void* output,
+                      unsigned long num_frames,
+                      const PaStreamCallbackTimeInfo* time_info,
+                      PaStreamCallbackFlags status_flags, void* user_data)
+{
+  RealtimeScope realtime;
+  DspThread* dsp = static_cast<DspThread*>(user_data);
+  telemetry()->countCallback();
+  if (status_flags & paInputOverflow)
+    telemetry()->countInputOverflow();
+  const Sample* cur_samples = static_cast<const Sample*>(input);
+  if (cur_samples)
+    dsp->enqueueBlock(cur_samples, num_frames, adcNanos(time_info));
+  else
+    dsp->heartbeatWithoutInput();
+  return paContinue;
+}
@@ -0,0 +1,63 @@
+#ifndef CLICKITONGUE_DSP_THREAD_H_
+#define CLICKITONGUE_DSP_THREAD_H_
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "portaudio.h"
+
+#include "constants.h"
+#include "fft_result_distributor.h"
+#include "spsc_ring.h"
+#include "wakeup.h"
+
+constexpr int kMaxInputChannels = 2;
+
+// One PortAudio callback's worth of (interleaved) input.
+struct AudioBlock
+{
+  Sample samples[kMaxFourierBlocksize * kMaxInputChannels];
+  int num_frames;
+  int64_t adc_nanos;
+};
+
+// Optional (--dsp_thread): moves FFTResultDistributor::processAudio() out of
+// the PortAudio callback, leaving the callback (dspThreadCallback) with just a
+// memcpy into a lock-free ring, and a Wakeup of the thread draining it. That
+// thread - SCHED_FIFO, and pinned to one core, on Linux - feeds the ring to
+// the distributor. So, heavier DSP
+// can't make the host's audio thread miss its deadline; at worst the DSP
+// thread falls behind, and blocks beyond max_queue_blocks are dropped (and
+// counted, see Telemetry).
+class DspThread
+{
+public:
+  static constexpr int kMaxQueueBlocks = 64;
+
+  // max_queue_blocks: at most kMaxQueueBlocks.
+  DspThread(FFTResultDistributor* distributor, int max_queue_blocks);
+  // Stops and joins the thread; the audio stream must already be stopped.
+  ~DspThread();
+
+  // Audio thread only.
+  void enqueueBlock(const Sample* samples, int num_frames, int64_t adc_nanos);
+  void heartbeatWithoutInput();
+
+private:
+  void run();
+
+  FFTResultDistributor* const distributor_;
+  const int max_queue_blocks_;
+  SpscRing<AudioBlock, kMaxQueueBlocks> ring_;
+  Wakeup wakeup_;
+  std::atomic<bool> stop_{false};
+  std::thread thread_;
+};
+
+int dspThreadCallback(const void* input, void* output,
+                      unsigned long num_frames,
+                      const PaStreamCallbackTimeInfo* time_info,
+                      PaStreamCallbackFlags status_flags, void* user_data);
+
+#endif // CLICKITONGUE_DSP_THREAD_H_
@@ -4,6 +4,9 @@
 
 #include "config_io.h"
 #include "constants.h"
+#include "dsp_kernels.h"
+
+void crash(const char* s);
 
 EasyFourier* g_fourier = nullptr;
 
@@ -18,25 +21,46 @@ double* makeBinFreqs()
 
 void loadOrCreateWisdom()
 {
-  std::string wisdom_path = getAndEnsureConfigDir() + "1d_blocksize" +
-                            std::to_string(kFourierBlocksize)+"_real_to_complex.fftw_wisdom";
-  if (!fftw_import_wisdom_from_filename(wisdom_path.c_str()))
+#ifdef CLICKITONGUE_FFT_DOUBLE
+  const char kPrecision[] = "";
+#else
+  const char kPrecision[] = "_float";
+#endif
+  // (One file for all of kSupportedBlocksizes).
+  std::string wisdom_path = getAndEnsureConfigDir() + "1d_blocksizes" +
+                            std::to_string(kSupportedBlocksizes[0]) + "to" +
+                            std::to_string(kMaxFourierBlocksize) + "_real_to_complex" +
+                            kPrecision + ".fftw_wisdom";
+  if (!FFTW_FN(import_wisdom_from_filename)(wisdom_path.c_str()))
   {
     printf("No wisdom file found. Will now let FFTW practice a bit to learn...\n");
-    double* in = fftw_alloc_real(kFourierBlocksize);
-    fftw_complex* out = fftw_alloc_complex(kNumFourierBins);
-    fftw_plan fft_plan = fftw_plan_dft_r2c_1d(kFourierBlocksize, in, out, FFTW_PATIENT | FFTW_DESTROY_INPUT);
+    FourierReal* in = FFTW_FN(alloc_real)(kMaxFourierBlocksize);
+    FourierComplex* out = FFTW_FN(alloc_complex)(kMaxFourierBlocksize/2 + 1);
+    for (int blocksize : kSupportedBlocksizes)
+    {
+      FFTW_FN(destroy_plan)(FFTW_FN(plan_dft_r2c_1d)(
+          blocksize, in, out, FFTW_PATIENT | FFTW_DESTROY_INPUT));
+    }
     printf("Wisdom acquired. Now writing...");
-    if (!fftw_export_wisdom_to_filename(wisdom_path.c_str()))
+    if (!FFTW_FN(export_wisdom_to_filename)(wisdom_path.c_str()))
       printf("unable to write to %s\n", wisdom_path.c_str());
     else
       printf("done.\n");
-    fftw_free(in);
-    fftw_free(out);
-    fftw_destroy_plan(fft_plan);
+    FFTW_FN(free)(in);
+    FFTW_FN(free)(out);
   }
 }
 
+// Index into FourierWorker::fft_plans of blocksize's plan.
+int planIndex(int blocksize)
+{
+  for (int i = 0; i < kNumBlocksizePlans; i++)
+    if (kSupportedBlocksizes[i] == blocksize)
+      return i;
+  crash("no FFT plan for that block size");
+  return 0;
+}
+
 EasyFourier::EasyFourier() : bin_freq_(makeBinFreqs())
 {
   // (have to load / create wisdom BEFORE creating FourierWorkers, or else the
@@ -50,6 +74,7 @@ EasyFourier::EasyFourier() : bin_freq_(makeBinFreqs())
     num_threads = 32;
   for (int i=0; i<num_threads; i++)
     workers_.emplace_back(std::make_unique<FourierWorker>());
+  free_workers_ = (num_threads == 64) ? ~0ull : ((1ull << num_threads) - 1);
 }
 
 EasyFourier::~EasyFourier()
@@ -59,9 +84,17 @@ EasyFourier::~EasyFourier()
 
 FourierLease EasyFourier::borrowWorker()
 {
-  int id = pickAndLockWorker();
+  int id = tryClaimWorker();
+  if (id < 0)
+  {
+    borrow_waits_++;
+    std::unique_lock<std::mutex> lock(wait_mutex_);
+    num_waiting_++;
+    worker_released_.wait(lock, [this, &id] { return (id = tryClaimWorker()) >= 0; });
+    num_waiting_--;
+  }
   return FourierLease(workers_[id]->in, workers_[id]->out,
-                      workers_[id]->fft_plan, id, this);
+                      workers_[id]->fft_plans, id, this);
 }
 
 double EasyFourier::freqOfBin(int index) const { return bin_freq_[index]; }
@@ -80,7 +113,7 @@ int EasyFourier::binContainingFreq(double freq) const
   return lower_bound+1;
 }
 
-void EasyFourier::printOctavesAlreadyFreq(fftw_complex* powers) const
+void EasyFourier::printOctavesAlreadyFreq(FourierComplex* powers) const
 {
   double o1 = powers[1][0];
   double o2 = powers[2][0]+powers[3][0];
@@ -97,7 +130,7 @@ void EasyFourier::printOctavesAlreadyFreq(fftw_complex* powers) const
 void EasyFourier::printOctavePowers(const float* samples)
 {
   FourierLease lease = borrowWorker();
-  for (int i=0; i<kFourierBlocksize; i++)
+  for (int i=0; i<kDefaultFourierBlocksize; i++)
   {
     if (g_num_channels == 2)
       lease.in[i] = (samples[i*g_num_channels] + samples[i*g_num_channels + 1]) / 2.0;
@@ -111,13 +144,13 @@ void EasyFourier::printOctavePowers(const float* samples)
   printOctavesAlreadyFreq(lease.out);
 }
 
-double powerIfInBounds(fftw_complex* bins, int i)
+double powerIfInBounds(FourierComplex* bins, int i)
 {
-  if (i < 1 || i > kFourierBlocksize/2)
+  if (i < 1 || i > kDefaultFourierBlocksize/2)
     return 0;
   return bins[i][0];
 }
-bool isSpike(fftw_complex* p, int i)
+bool isSpike(FourierComplex* p, int i)
 {
   return powerIfInBounds(p, i-1) < p[i][0] && powerIfInBounds(p, i-2) < p[i][0] &&
          powerIfInBounds(p, i+1) < p[i][0] && powerIfInBounds(p, i+2) < p[i][0];
@@ -125,7 +158,7 @@ bool isSpike(fftw_complex* p, int i)
 void EasyFourier::printTopTwoSpikes(const float* samples)
 {
   FourierLease lease = borrowWorker();
-  for (int i=0; i<kFourierBlocksize; i++)
+  for (int i=0; i<kDefaultFourierBlocksize; i++)
   {
     if (g_num_channels == 2)
       lease.in[i] = (samples[i*g_num_channels] + samples[i*g_num_channels + 1]) / 2.0;
@@ -161,7 +194,7 @@ void EasyFourier::printTopTwoSpikes(const float* samples)
 void EasyFourier::printOvertones(const float* samples)
 {
   FourierLease lease = borrowWorker();
-  for (int i=0; i<kFourierBlocksize; i++)
+  for (int i=0; i<kDefaultFourierBlocksize; i++)
   {
     if (g_num_channels == 2)
       lease.in[i] = (samples[i*g_num_channels] + samples[i*g_num_channels + 1]) / 2.0;
@@ -211,7 +244,7 @@ void EasyFourier::printOvertones(const float* samples)
 void EasyFourier::printEqualizer(const float* samples)
 {
   FourierLease lease = borrowWorker();
-  for (int i=0; i<kFourierBlocksize; i++)
+  for (int i=0; i<kDefaultFourierBlocksize; i++)
   {
     if (g_num_channels == 2)
       lease.in[i] = (samples[i*g_num_channels] + samples[i*g_num_channels + 1]) / 2.0;
@@ -229,12 +262,12 @@ void EasyFourier::printEqualizer(const float* samples)
   for (int height = kMaxHeight; height > 0; height--)
   {
     int y = kMaxHeight - height;
-    for (int x = 0; x < kFourierBlocksize / 2; x++)
+    for (int x = 0; x < kDefaultFourierBlocksize / 2; x++)
       if (lease.out[x+1][0] > 2*height)
         bars[columns * y + x] = '0';
       else
         bars[columns * y + x] = ' ';
-    bars[columns * y + kFourierBlocksize / 2] = '\n';
+    bars[columns * y + kDefaultFourierBlocksize / 2] = '\n';
   }
   printf("\e[1;1H\e[2J");
   bars[columns * kMaxHeight] = 0;
@@ -244,7 +277,7 @@ void EasyFourier::printEqualizer(const float* samples)
 void EasyFourier::printMaxBucket(const float* samples)
 {
   FourierLease lease = borrowWorker();
-  for (int i=0; i<kFourierBlocksize; i++)
+  for (int i=0; i<kDefaultFourierBlocksize; i++)
   {
     if (g_num_channels == 2)
       lease.in[i] = (samples[i*g_num_channels] + samples[i*g_num_channels + 1]) / 2.0;
@@ -268,42 +301,74 @@ void EasyFourier::printMaxBucket(const float* samples)
   printf("%g: %g\n", fraction * kNyquist, max);
 }
 
-int EasyFourier::pickAndLockWorker()
+uint64_t EasyFourier::borrowWaits() const { return borrow_waits_; }
+
+int EasyFourier::tryClaimWorker()
 {
-  while (true)
+  // Each thread first tries whichever worker it had last time. In the common
+  // case of one long-lived lease per thread (or one thread borrowing over and
+  // over), that's a single atomic op, and keeps the worker's buffers in this
+  // thread's cache.
+  thread_local int preferred = -1;
+  if (preferred >= 0)
   {
-    for (int i=0; i<workers_.size(); i++)
-      if (workers_[i]->mutex.try_lock())
-        return i;
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    uint64_t bit = 1ull << preferred;
+    if (free_workers_.fetch_and(~bit) & bit)
+      return preferred;
   }
+  uint64_t free_mask = free_workers_.load();
+  while (free_mask != 0)
+  {
+    int id = __builtin_ctzll(free_mask);
+    uint64_t bit = 1ull << id;
+    if (free_workers_.compare_exchange_weak(free_mask, free_mask & ~bit))
+    {
+      preferred = id;
+      return id;
+    }
+  }
+  return -1;
 }
 
 void EasyFourier::releaseWorker(int id)
 {
-  workers_[id]->mutex.unlock();
+  free_workers_.fetch_or(1ull << id);
+  if (num_waiting_.load() > 0)
+  {
+    // (Taking the lock ensures a borrower that just failed to claim is already
+    //  waiting, and so will see this notification).
+    { const std::lock_guard<std::mutex> lock(wait_mutex_); }
+    worker_released_.notify_one();
+  }
 }
 
 EasyFourier::FourierWorker::FourierWorker()
-  : in(fftw_alloc_real(kFourierBlocksize)),
-    out(fftw_alloc_complex(kNumFourierBins)),
-    fft_plan(fftw_plan_dft_r2c_1d(kFourierBlocksize, in, out, FFTW_PATIENT | FFTW_DESTROY_INPUT))
-{}
+  : in(FFTW_FN(alloc_real)(kMaxFourierBlocksize)),
+    out(FFTW_FN(alloc_complex)(kMaxFourierBlocksize/2 + 1))
+{
+  for (int i = 0; i < kNumBlocksizePlans; i++)
+  {
+    fft_plans[i] = FFTW_FN(plan_dft_r2c_1d)(kSupportedBlocksizes[i], in, out,
+                                            FFTW_PATIENT | FFTW_DESTROY_INPUT);
+  }
+}
 
 EasyFourier::FourierWorker::~FourierWorker()
 {
-  fftw_free(in);
-  fftw_free(out);
-  fftw_destroy_plan(fft_plan);
+  FFTW_FN(free)(in);
+  FFTW_FN(free)(out);
+  for (FourierPlan plan : fft_plans)
+    FFTW_FN(destroy_plan)(plan);
 }
 
-FourierLease::FourierLease(double* input, fftw_complex* output, fftw_plan plan,
-                           int i, EasyFourier* p)
-  : in(input), out(output), fft_plan(plan), id(i), parent(p) {}
+FourierLease::FourierLease(FourierReal* input, FourierComplex* output,
+                           const FourierPlan* plans, int i, EasyFourier* p)
+  : in(input), out(output), fft_plans(plans), id(i), parent(p) {}
 
-void FourierLease::runFFT()
+void FourierLease::runFFT(int blocksize)
 {
-  fftw_execute(fft_plan); // (fft_plan is assumed to point at in and out).
+  // (The plans are all assumed to point at in and out).
+  FFTW_FN(execute)(fft_plans[planIndex(blocksize)]);
 }
 
 FourierLease::~FourierLease() { parent->releaseWorker(id); }
@@ -1,6 +1,9 @@
 #ifndef CLICKITONGUE_EASY_FOURIER_H_
 #define CLICKITONGUE_EASY_FOURIER_H_
 
+#include <atomic>
+#include <condition_variable>
+#include <iterator>
 #include <memory>
 #include <mutex>
 #include <vector>
@@ -9,43 +12,68 @@
 
 #include "constants.h"
 
+// The FFT pipeline runs in single precision by default (FFTW's fftwf_*
+// interface; link with -lfftw3f). Build with -DCLICKITONGUE_FFT_DOUBLE to get
+// the double precision pipeline instead (link with -lfftw3), e.g. to compare
+// accuracy.
+#ifdef CLICKITONGUE_FFT_DOUBLE
+using FourierReal = double;
+typedef fftw_complex FourierComplex;
+typedef fftw_plan FourierPlan;
+#define FFTW_FN(name) fftw_##name
+#else
+using FourierReal = float;
+typedef fftwf_complex FourierComplex;
+typedef fftwf_plan FourierPlan;
+#define FFTW_FN(name) fftwf_##name
+#endif
+
 // Safe, orderly multithreaded invocations of FFTW's 1d real-to-complex FFT.
 
 // Usage:
 // 1) Get a FourierLease from EasyFourier using borrowWorker()
-// 2) Load your input into lease.in (an array of kFourierBlocksize reals)
-// 3) Call lease.runFFT()
-// 4) Read from lease.out (an array of kFourierBlocksize/2 + 1 complexes)
+// 2) Load your input into lease.in (blocksize reals, for any blocksize in
+//    kSupportedBlocksizes)
+// 3) Call lease.runFFT(blocksize)
+// 4) Read from lease.out (blocksize/2 + 1 complexes)
 // 5) Let the lease go out of scope to release its worker.
 
 struct FourierLease;
 
+constexpr int kNumBlocksizePlans = std::size(kSupportedBlocksizes);
+
 class EasyFourier
 {
 public:
   EasyFourier();
   ~EasyFourier();
 
+  // Wait-free unless every worker is already lent out, in which case it
+  // blocks until one is returned.
   FourierLease borrowWorker();
 
+  // How many borrowWorker() calls have found every worker lent out, and had to
+  // wait for one to be returned.
+  uint64_t borrowWaits() const;
+
   // Returns the frequency center of the provided bin index.
   double freqOfBin(int index) const;
   // Inverse (loosely) of freqOfBin
   int binContainingFreq(double freq) const;
 
-  // length of samples should be kFourierBlocksize.
+  // length of samples should be kDefaultFourierBlocksize.
   void printEqualizer(const float* samples);
   void printTopTwoSpikes(const float* samples);
   void printOctavePowers(const float* samples);
-  void printOctavesAlreadyFreq(fftw_complex* powers) const;
+  void printOctavesAlreadyFreq(FourierComplex* powers) const;
   void printOvertones(const float* samples);
 
-  // length of freq_buckets should be kFourierBlocksize / 2 + 1.
-  // (i.e. the output of a real-to-complex FFT with length kFourierBlocksize input)
-  void printEqualizerAlreadyFreq(fftw_complex* freq_buckets) const;
+  // length of freq_buckets should be kDefaultFourierBlocksize / 2 + 1.
+  // (i.e. the output of a real-to-complex FFT with length kDefaultFourierBlocksize input)
+  void printEqualizerAlreadyFreq(FourierComplex* freq_buckets) const;
 
   // prints the frequency bucket with the most energy, and its energy.
-  // length of samples should be kFourierBlocksize.
+  // length of samples should be kDefaultFourierBlocksize.
   void printMaxBucket(const float* samples);
 
 private:
@@ -57,14 +85,24 @@ private:
   public:
     FourierWorker();
     ~FourierWorker();
-    double* in;
-    fftw_complex* out;
-    fftw_plan fft_plan;
-    std::mutex mutex;
+    FourierReal* in;
+    FourierComplex* out;
+    // One per kSupportedBlocksizes entry, all reading in and writing out.
+    FourierPlan fft_plans[kNumBlocksizePlans];
   };
-  int pickAndLockWorker();
+  // Returns the index of a worker we now own, or -1 if none are free.
+  int tryClaimWorker();
   std::vector<std::unique_ptr<FourierWorker>> workers_;
 
+  // Bit i is set iff workers_[i] is available to be borrowed.
+  std::atomic<uint64_t> free_workers_{0};
+  std::atomic<uint64_t> borrow_waits_{0};
+  // Only used when every worker is lent out. Releasers only touch these if
+  // someone is actually waiting.
+  std::atomic<int> num_waiting_{0};
+  std::mutex wait_mutex_;
+  std::condition_variable worker_released_;
+
   double bin_width_;
   double half_width_;
   const double* bin_freq_;
@@ -73,19 +111,22 @@ private:
 struct FourierLease
 {
 public:
-  FourierLease(double* input, fftw_complex* output, fftw_plan plan,
-               int i, EasyFourier* p);
+  FourierLease(FourierReal* input, FourierComplex* output,
+               const FourierPlan* plans, int i, EasyFourier* p);
   ~FourierLease();
 
-  void runFFT(); // reads from this struct's 'in', writes to its 'out'
+  // Reads the first blocksize elements of this struct's 'in', writes the
+  // first blocksize/2 + 1 of its 'out'. blocksize: from kSupportedBlocksizes.
+  // (For the per-block pipeline around this, see SpectrumPipeline).
+  void runFFT(int blocksize = kDefaultFourierBlocksize);
 
-  // length: parent->blocksize elements
-  double* in;
-  // length: parent->blocksize / 2 + 1 elements
-  fftw_complex* out;
+  // length: kMaxFourierBlocksize elements
+  FourierReal* in;
+  // length: kMaxFourierBlocksize / 2 + 1 elements
+  FourierComplex* out;
 
 private:
-  fftw_plan fft_plan;
+  const FourierPlan* fft_plans;
   int id;
   EasyFourier* parent;
 };
@@ -1,8 +1,16 @@
 #include "fft_result_distributor.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cstdio>
+#include <cstring>
+#include <utility>
+
+#include "realtime_check.h"
+#include "telemetry.h"
 
 void safelyExit(int exit_code);
+void crash(const char* s);
 
 #ifdef CLICKITONGUE_LINUX
 #include <unistd.h>
@@ -28,68 +36,173 @@ void restartProgram()
 }
 
 extern volatile sig_atomic_t g_shutdown_flag;
-#include <thread>
-void watchdog(FFTResultDistributor* distrib)
-{
-  std::this_thread::sleep_for(std::chrono::seconds(1));
-  while (true)
-  {
-    std::this_thread::sleep_for(std::chrono::milliseconds(500));
-    uint64_t dog_time = distrib->watchdog_time_;
-    uint64_t cur_time = std::chrono::duration_cast<std::chrono::seconds>(
-      std::chrono::system_clock::now().time_since_epoch()).count();
-    if (g_shutdown_flag)
-      safelyExit(0);
-    if (cur_time - dog_time > 1)
-      restartProgram();
-  }
-}
 #endif
 
+bool g_show_debug_info = false;
+
 FFTResultDistributor::FFTResultDistributor(
     std::vector<std::unique_ptr<Detector>>&& detectors,
     double scale, bool training)
-: detectors_(std::move(detectors)), fft_lease_(g_fourier->borrowWorker()),
-  scale_(scale), training_(training)
+: detectors_(std::move(detectors)), lease_(g_fourier->borrowWorker()),
+  training_(training)
 {
-#ifdef CLICKITONGUE_LINUX
-  std::thread(watchdog, this).detach();
-#endif
+  // (block size, hop) of each resolution.
+  std::vector<std::pair<int, int>> shapes;
+  for (auto const& detector : detectors_)
+    shapes.emplace_back(detector->blocksize(), detector->hop());
+  if (shapes.empty())
+    shapes.emplace_back(g_fourier_blocksize, g_fourier_hop);
+  std::sort(shapes.begin(), shapes.end());
+  shapes.erase(std::unique(shapes.begin(), shapes.end()), shapes.end());
+  // (Hops are powers of 2, so the smallest divides all the others).
+  input_blocksize_ = std::min_element(
+      shapes.begin(), shapes.end(),
+      [](auto const& a, auto const& b) { return a.second < b.second; })->second;
+
+  int max_blocksize = 0;
+  for (auto [blocksize, hop] : shapes)
+  {
+    if (!isSupportedBlocksize(blocksize) || !isSupportedHop(hop, blocksize))
+      crash("detector has an unsupported Fourier block size or hop");
+    max_blocksize = std::max(max_blocksize, blocksize);
+    Resolution res;
+    SpectrumPipelineOptions options;
+    options.hop = hop;
+    options.shared_lease = &lease_;
+    for (auto const& detector : detectors_)
+    {
+      if (detector->blocksize() != blocksize || detector->hop() != hop)
+        continue;
+      res.detectors.push_back(detector.get());
+      options.track_pitch = options.track_pitch || detector->wantsPitch();
+    }
+    res.pipeline = makeSpectrumPipeline(blocksize, g_num_channels, scale, options);
+    resolutions_.push_back(std::move(res));
+  }
+  if (max_blocksize > input_blocksize_)
+    history_.resize(2 * kMaxFourierBlocksize * g_num_channels, kSilentSample);
 }
 
 void FFTResultDistributor::
 replaceDetectors(std::vector<std::unique_ptr<Detector>>&& detectors)
 {
   detectors_ = std::move(detectors);
+  for (Resolution& res : resolutions_)
+    res.detectors.clear();
+  for (auto& detector : detectors_)
+  {
+    auto res = std::find_if(resolutions_.begin(), resolutions_.end(),
+                            [&](Resolution const& r)
+                            { return r.pipeline->blocksize() == detector->blocksize() &&
+                                     r.pipeline->hop() == detector->hop(); });
+    if (res == resolutions_.end())
+      crash("replacement detector has a block size or hop the distributor wasn't built with");
+    res->detectors.push_back(detector.get());
+  }
 }
 
-bool g_show_debug_info = false;
-void FFTResultDistributor::processAudio(const Sample* cur_sample, int num_frames)
+const Sample* FFTResultDistributor::historyWindow(int blocksize) const
 {
-  if (num_frames != kFourierBlocksize)
+  return history_.data() +
+         (history_pos_ + kMaxFourierBlocksize - blocksize) * g_num_channels;
+}
+
+void FFTResultDistributor::processAudio(const Sample* cur_sample, int num_frames,
+                                        int64_t adc_nanos)
+{
+  if (num_frames != input_blocksize_)
   {
-    printf("illegal num_frames: expected %d, got %d\n", kFourierBlocksize, num_frames);
+    printf("illegal num_frames: expected %d, got %d\n", input_blocksize_, num_frames);
     safelyExit(1);
   }
 
-  for (int i=0; i<kFourierBlocksize; i++)
+  if (!history_.empty())
   {
-    if (g_num_channels == 2)
-      fft_lease_.in[i] = (cur_sample[i*g_num_channels] + cur_sample[i*g_num_channels+1]) / 2.0;
-    else
-      fft_lease_.in[i] = cur_sample[i];
+    // (Every block size divides kMaxFourierBlocksize, so a block never wraps).
+    const size_t bytes = num_frames * g_num_channels * sizeof(Sample);
+    memcpy(history_.data() + history_pos_ * g_num_channels, cur_sample, bytes);
+    memcpy(history_.data() + (history_pos_ + kMaxFourierBlocksize) * g_num_channels,
+           cur_sample, bytes);
+    history_pos_ = (history_pos_ + num_frames) % kMaxFourierBlocksize;
   }
-  fft_lease_.runFFT();
 
-  for (int i=0; i<kNumFourierBins; i++)
+  for (Resolution& res : resolutions_)
   {
-    fft_lease_.out[i][0] = scale_ * (fft_lease_.out[i][0]*fft_lease_.out[i][0] +
-                                     fft_lease_.out[i][1]*fft_lease_.out[i][1]);
+    const int blocksize = res.pipeline->blocksize();
+    res.frames_pending += num_frames;
+    if (res.frames_pending < res.pipeline->hop())
+      continue;
+    res.frames_pending = 0;
+
+    const Sample* window = blocksize == num_frames ? cur_sample : historyWindow(blocksize);
+    // (A bigger window's first frame was captured that much earlier).
+    const int64_t window_adc_nanos = adc_nanos == 0 ? 0 :
+        adc_nanos - (int64_t)(blocksize - num_frames) * 1000000000 / kFramesPerSec;
+    BandFeatures const& features = res.pipeline->process(window);
+    for (Detector* detector : res.detectors)
+      detector->processBlock(features, window_adc_nanos);
+    if (g_show_debug_info && !training_ && &res == &resolutions_.front())
+      telemetry()->recordOctaves(features);
   }
-  for (auto& detector : detectors_)
-    detector->processFourierOutputBlock(fft_lease_.out);
-  if (g_show_debug_info && !training_)
-    g_fourier->printOctavesAlreadyFreq(fft_lease_.out);
+  heartbeat_.fetch_add(1, std::memory_order_relaxed);
+}
+
+AudioWatchdog::AudioWatchdog(FFTResultDistributor const* distributor)
+  : distributor_(distributor)
+{
+#ifdef CLICKITONGUE_LINUX
+  thread_ = std::thread(&AudioWatchdog::run, this);
+#endif
+}
+
+AudioWatchdog::~AudioWatchdog()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  stop_cv_.notify_all();
+  if (thread_.joinable())
+    thread_.join();
+}
+
+void AudioWatchdog::run()
+{
+#ifdef CLICKITONGUE_LINUX
+  // Returns false once we've been asked to stop.
+  auto sleepFor = [this](std::chrono::milliseconds duration)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return !stop_cv_.wait_for(lock, duration, [this] { return stopping_; });
+  };
+  if (!sleepFor(std::chrono::seconds(1)))
+    return;
+  uint64_t last_beat = distributor_->heartbeat_.load(std::memory_order_relaxed);
+  int silent_checks = 0;
+  while (sleepFor(std::chrono::milliseconds(500)))
+  {
+    if (g_shutdown_flag)
+      safelyExit(0);
+    uint64_t beat = distributor_->heartbeat_.load(std::memory_order_relaxed);
+    silent_checks = beat == last_beat ? silent_checks + 1 : 0;
+    last_beat = beat;
+    if (silent_checks >= 3) // no audio for well over a second
+      restartProgram();
+  }
+#endif
+}
+
+// PortAudio's timestamps are on the stream's own clock, so translate via the
+// ADC time's offset from currentTime (roughly "now").
+int64_t adcNanos(const PaStreamCallbackTimeInfo* time_info)
+{
+  int64_t now = latencyNowNanos();
+  if (!time_info || time_info->inputBufferAdcTime <= 0 ||
+      time_info->currentTime < time_info->inputBufferAdcTime)
+  {
+    return now;
+  }
+  return now - (int64_t)((time_info->currentTime - time_info->inputBufferAdcTime) * 1e9);
 }
 
 int fftDistributorCallback(const void* input, void* output,
@@ -97,13 +210,15 @@ int fftDistributorCallback(const void* input, void* output,
                            const PaStreamCallbackTimeInfo* time_info,
                            PaStreamCallbackFlags status_flags, void* user_data)
 {
+  RealtimeScope realtime;
   FFTResultDistributor* distrib = static_cast<FFTResultDistributor*>(user_data);
+  telemetry()->countCallback();
+  if (status_flags & paInputOverflow)
+    telemetry()->countInputOverflow();
   const Sample* cur_samples = static_cast<const Sample*>(input);
   if (cur_samples)
-    distrib->processAudio(cur_samples, num_frames);
-#ifdef CLICKITONGUE_LINUX
-  distrib->watchdog_time_ = std::chrono::duration_cast<std::chrono::seconds>(
-    std::chrono::system_clock::now().time_since_epoch()).count();
-#endif
+    distrib->processAudio(cur_samples, num_frames, adcNanos(time_info));
+  else
+    distrib->heartbeat_.fetch_add(1, std::memory_order_relaxed);
   return paContinue;
 }
@@ -1,35 +1,107 @@
 #ifndef CLICKITONGUE_FFT_RESULT_DISTRIBUTOR_H_
 #define CLICKITONGUE_FFT_RESULT_DISTRIBUTOR_H_
 
-#include <optional>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "portaudio.h"
 
+#include "band_features.h"
 #include "detector.h"
-#include "easy_fourier.h"
 #include "constants.h"
+#include "spectrum_pipeline.h"
 
 // PortAudio has, through a callback, given us a block of samples. Do a single
-// FFT and pass the same result to all detectors present.
+// FFT, reduce it to BandFeatures, and pass those to all detectors present.
+//
+// More precisely, one FFT per resolution: each detector is fed by a
+// SpectrumPipeline of its own blocksize() and hop() (detectors with the same
+// ones share it), so e.g. a transient detector can decide every 128 frames
+// while a tonal one looks at 1024. Input comes in blocks of the smallest of
+// the hops; each resolution runs once every hop() frames, on the latest
+// blocksize() frames of a shared input history. So, each detector sees exactly
+// what it would if everything ran at its block size and hop.
 class FFTResultDistributor
 {
 public:
   FFTResultDistributor(std::vector<std::unique_ptr<Detector>>&& detectors,
                        double scale, bool training);
 
-  void processAudio(const Sample* cur_sample, int num_frames);
+  // num_frames: must be inputBlocksize().
+  // adc_nanos: see Detector::processBlock().
+  void processAudio(const Sample* cur_sample, int num_frames,
+                    int64_t adc_nanos = 0);
 
+  // The smallest of the detectors' hops (g_fourier_hop as of construction, if
+  // there are no detectors).
+  int inputBlocksize() const { return input_blocksize_; }
+
+  // (The resolutions, and whether each tracks the hum's pitch, are decided at
+  // construction, from the original detectors).
   void replaceDetectors(std::vector<std::unique_ptr<Detector>>&& detectors);
 
-  std::atomic<uint64_t> watchdog_time_{0};
+  // Bumped for every block processed (or callback without input). See
+  // AudioWatchdog.
+  std::atomic<uint64_t> heartbeat_{0};
 private:
+  struct Resolution
+  {
+    std::unique_ptr<SpectrumPipeline> pipeline;
+    std::vector<Detector*> detectors;
+    int frames_pending = 0; // input since this resolution last ran
+  };
+
+  // The latest blocksize frames of input (blocksize <= kMaxFourierBlocksize).
+  const Sample* historyWindow(int blocksize) const;
+
   std::vector<std::unique_ptr<Detector>> detectors_;
-  FourierLease fft_lease_;
-  const double scale_;
+  // The worker every resolution's FFTs run on. (They all run one after
+  // another, in processAudio(), so they can share it).
+  FourierLease lease_;
+  // Smallest block size first.
+  std::vector<Resolution> resolutions_;
+  int input_blocksize_;
+  // Interleaved input frames, for resolutions bigger than the input blocks
+  // (empty if there are none). Each frame is written twice,
+  // kMaxFourierBlocksize frames apart, so every recent window is contiguous.
+  std::vector<Sample> history_;
+  int history_pos_ = 0; // in frames; where the next frame goes
   // Whether these FFTs are being done on pre-recorded data, for training.
   const bool training_;
 };
 
+// Live operation only (offline users of FFTResultDistributor, like replay and
+// the benchmark, just don't make one). On Linux, watches distributor's
+// heartbeat_ from its own thread, and restarts the program if that stops
+// changing for over a second, since that means the audio stream has died; it
+// also exits once g_shutdown_flag is set. (Elsewhere, it does nothing). Must
+// not outlive distributor; destruction stops and joins the thread.
+class AudioWatchdog
+{
+public:
+  explicit AudioWatchdog(FFTResultDistributor const* distributor);
+  ~AudioWatchdog();
+
+private:
+  void run();
+
+  FFTResultDistributor const* const distributor_;
+  std::mutex mutex_;
+  std::condition_variable stop_cv_;
+  bool stopping_ = false;
+  std::thread thread_;
+};
+
+// When the first sample of a callback's input block hit the ADC, in
+// latencyNowNanos() time. Hosts that don't report timestamps (they're 0) get
+// the callback's start time: the ADC->decision latency then omits the input
+// buffering, but still covers our own processing.
+int64_t adcNanos(const PaStreamCallbackTimeInfo* time_info);
+
 int fftDistributorCallback(const void* input, void* output,
                            unsigned long num_frames,
                            const PaStreamCallbackTimeInfo* time_info,
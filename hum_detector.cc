@@ -1,39 +1,39 @@
 #include "hum_detector.h"
 
-HumDetector::HumDetector(BlockingQueue<Action>* action_queue,
+HumDetector::HumDetector(ActionRing* action_queue,
                          double o1_on_thresh, double o1_off_thresh,
                          double o6_limit, double ewma_alpha, bool require_delay,
                          std::vector<int>* cur_frame_dest)
   : Detector(Action::RecordCurFrame, Action::NoAction, action_queue, cur_frame_dest),
     o1_on_thresh_(o1_on_thresh), o1_off_thresh_(o1_off_thresh),
-    o6_limit_(o6_limit), ewma_alpha_(ewma_alpha),
-    one_minus_ewma_alpha_(1.0-ewma_alpha_), require_delay_(require_delay)
-{}
+    o6_limit_(o6_limit), ewma_alpha_(ewma_alpha), require_delay_(require_delay)
+{
+  resolutionChanged();
+}
 
-HumDetector::HumDetector(BlockingQueue<Action>* action_queue,
+HumDetector::HumDetector(ActionRing* action_queue,
                          Action action_on, Action action_off,
                          double o1_on_thresh, double o1_off_thresh,
                          double o6_limit, double ewma_alpha, bool require_delay)
   : Detector(action_on, action_off, action_queue),
     o1_on_thresh_(o1_on_thresh), o1_off_thresh_(o1_off_thresh),
-    o6_limit_(o6_limit), ewma_alpha_(ewma_alpha),
-    one_minus_ewma_alpha_(1.0-ewma_alpha_), require_delay_(require_delay)
-{}
-
-void HumDetector::updateState(const fftw_complex* freq_power)
+    o6_limit_(o6_limit), ewma_alpha_(ewma_alpha), require_delay_(require_delay)
 {
-  o1_ewma_ = o1_ewma_ * one_minus_ewma_alpha_ + freq_power[1][0] * ewma_alpha_;
+  resolutionChanged();
+}
 
-  double cur_o6 = 0;
-  for (int i=32; i<64; i++)
-    cur_o6 += freq_power[i][0];
-  o6_ewma_ = o6_ewma_ * one_minus_ewma_alpha_ + cur_o6 * ewma_alpha_;
+void HumDetector::updateState(BandFeatures const& features)
+{
+  o1_ewma_ = o1_ewma_ * one_minus_hop_alpha_
+           + features.octave[kHumLowOctave] * hop_alpha_;
+  o6_ewma_ = o6_ewma_ * one_minus_hop_alpha_
+           + features.octave[kHumHighOctave] * hop_alpha_;
 }
 
 bool HumDetector::shouldTransitionOn()
 {
   if (delay_blocks_left_ < 0 && o1_ewma_ > o1_on_thresh_ && o6_ewma_ < o6_limit_)
-    delay_blocks_left_ = kHumDelayBlocks;
+    delay_blocks_left_ = delay_blocks_;
 
   if (delay_blocks_left_ > 0 && (!require_delay_ || --delay_blocks_left_ == 0))
   {
@@ -48,7 +48,16 @@ bool HumDetector::shouldTransitionOff()
   return o1_ewma_ < o1_off_thresh_;
 }
 
-int HumDetector::refracPeriodLengthBlocks() const { return 20; }
+int HumDetector::refracPeriodLengthBlocks() const { return refrac_blocks_; }
+
+void HumDetector::resolutionChanged()
+{
+  Detector::resolutionChanged();
+  hop_alpha_ = ewmaAlphaAtHop(ewma_alpha_, hop());
+  one_minus_hop_alpha_ = 1.0 - hop_alpha_;
+  delay_blocks_ = blocksIn(kHumDelayMs);
+  refrac_blocks_ = blocksIn(kHumRefracMs);
+}
 
 void HumDetector::resetEWMAs()
 {
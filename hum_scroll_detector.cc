@@ -0,0 +1,56 @@
+#include "hum_scroll_detector.h"
+
+#include <cmath>
+
+#include "pitch_tracker.h"
+
+namespace {
+
+// EWMA weight of each new pitch estimate (per kDefaultFourierBlocksize
+// frames; see ewmaAlphaAtHop()).
+constexpr double kPitchSmoothing = 0.5;
+// A bigger jump from one block to the next is a glitch (or a new note), not a
+// slide: start tracking afresh from there, without scrolling.
+constexpr double kMaxJumpSemitones = 2.0;
+// Even for a very fast slide, at most this many detents per block.
+constexpr int kMaxDetentsPerBlock = 3;
+
+} // namespace
+
+HumScrollDetector::HumScrollDetector(
+    ActionRing* action_queue, double o1_on_thresh, double o1_off_thresh,
+    double o6_limit, double ewma_alpha, bool require_delay)
+  : HumDetector(action_queue, Action::NoAction, Action::NoAction, o1_on_thresh,
+                o1_off_thresh, o6_limit, ewma_alpha, require_delay) {}
+
+void HumScrollDetector::updateState(BandFeatures const& features)
+{
+  HumDetector::updateState(features);
+  if (!on_ || features.pitch_hz <= 0)
+  {
+    have_pitch_ = false;
+    detents_owed_ = 0;
+    return;
+  }
+  const double semitones =
+      12.0 * std::log2(features.pitch_hz / ZoomPitchTracker::kMinHz);
+  if (!have_pitch_ || std::fabs(semitones - smoothed_semitones_) > kMaxJumpSemitones)
+  {
+    have_pitch_ = true;
+    smoothed_semitones_ = semitones;
+    return;
+  }
+  const double prev = smoothed_semitones_;
+  smoothed_semitones_ +=
+      ewmaAlphaAtHop(kPitchSmoothing, hop()) * (semitones - smoothed_semitones_);
+  const double block_secs = hop() / (double)kFramesPerSec;
+  if (std::fabs(smoothed_semitones_ - prev) / block_secs < kScrollDeadZone)
+    return;
+
+  detents_owed_ += kDetentsPerSemitone * (smoothed_semitones_ - prev);
+  for (int i = 0; i < kMaxDetentsPerBlock && std::fabs(detents_owed_) >= 1; i++)
+  {
+    emitAction(detents_owed_ > 0 ? Action::ScrollUp : Action::ScrollDown);
+    detents_owed_ -= detents_owed_ > 0 ? 1 : -1;
+  }
+}
@@ -0,0 +1,36 @@
+#ifndef CLICKITONGUE_HUM_SCROLL_DETECTOR_H_
+#define CLICKITONGUE_HUM_SCROLL_DETECTOR_H_
+
+#include "hum_detector.h"
+
+// Scroll by a semitone of pitch change per wheel detent: the scroll rate is
+// proportional to how fast the hum's pitch is sliding.
+constexpr double kDetentsPerSemitone = 1.0;
+// Pitch slides slower than this (semitones/sec) don't scroll, so that a
+// steady (if slightly wavering) hum stays put.
+constexpr double kScrollDeadZone = 3.0;
+
+// A HumDetector (same trained thresholds) that, rather than clicking, scrolls
+// while on: up as the hum's pitch rises, down as it falls. Needs
+// BandFeatures::pitch_hz.
+class HumScrollDetector : public HumDetector
+{
+public:
+  HumScrollDetector(ActionRing* action_queue,
+                    double o1_on_thresh, double o1_off_thresh, double o6_limit,
+                    double ewma_alpha, bool require_delay);
+
+  bool wantsPitch() const override { return true; }
+
+protected:
+  void updateState(BandFeatures const& features) override;
+
+private:
+  // Whether smoothed_semitones_ is tracking a pitch (of the current hum).
+  bool have_pitch_ = false;
+  double smoothed_semitones_ = 0;
+  // Scroll accumulated but not yet emitted (less than a whole detent).
+  double detents_owed_ = 0;
+};
+
+#endif // CLICKITONGUE_HUM_SCROLL_DETECTOR_H_
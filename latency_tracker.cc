@@ -0,0 +1,105 @@
+#include "latency_tracker.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "interaction.h"
+
+namespace {
+
+int highestBit(uint64_t x)
+{
+  int ret = 0;
+  while (x >>= 1)
+    ret++;
+  return ret;
+}
+
+} // namespace
+
+int64_t latencyNowNanos()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Values below 2^kSubBucketBits get a bucket each. Above that, [2^b, 2^(b+1))
+// is split into 2^kSubBucketBits equal buckets, at index (b-kSubBucketBits+1)
+// * 2^kSubBucketBits + (the kSubBucketBits bits below the top set bit).
+void LatencyHistogram::record(int64_t nanos)
+{
+  uint64_t val = nanos > 0 ? nanos : 0;
+  int ind;
+  if (val < (1u << kSubBucketBits))
+    ind = val;
+  else
+  {
+    int shift = highestBit(val) - kSubBucketBits;
+    ind = ((shift + 1) << kSubBucketBits) +
+          (int)((val >> shift) - (1u << kSubBucketBits));
+  }
+  buckets_[ind].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  sum_nanos_.fetch_add(val, std::memory_order_relaxed);
+  int64_t prev_max = max_nanos_.load(std::memory_order_relaxed);
+  while ((int64_t)val > prev_max &&
+         !max_nanos_.compare_exchange_weak(prev_max, val, std::memory_order_relaxed)) {}
+}
+
+int64_t LatencyHistogram::percentileNanos(double pct) const
+{
+  int64_t target = (int64_t)(pct / 100.0 * count());
+  int64_t seen = 0;
+  for (int ind = 0; ind < kNumBuckets; ind++)
+  {
+    seen += buckets_[ind].load(std::memory_order_relaxed);
+    if (seen > target)
+    {
+      if (ind < (1 << kSubBucketBits))
+        return ind;
+      int shift = (ind >> kSubBucketBits) - 1;
+      int64_t sub = (ind & ((1 << kSubBucketBits) - 1)) + (1 << kSubBucketBits);
+      return std::min(((sub + 1) << shift) - 1, maxNanos());
+    }
+  }
+  return maxNanos();
+}
+
+void LatencyHistogram::print(const char* name) const
+{
+  int64_t n = count();
+  if (n == 0)
+  {
+    PRINTF("  %-22s (none yet)\n", name);
+    return;
+  }
+  PRINTF("  %-22s n=%-6lld mean %8.1f  p50 %8.1f  p90 %8.1f  p99 %8.1f  "
+         "p99.9 %8.1f  max %8.1f\n", name, (long long)n,
+         sum_nanos_.load(std::memory_order_relaxed) / 1000.0 / n,
+         percentileNanos(50) / 1000.0, percentileNanos(90) / 1000.0,
+         percentileNanos(99) / 1000.0, percentileNanos(99.9) / 1000.0,
+         maxNanos() / 1000.0);
+}
+
+void ClickLatency::print() const
+{
+  PRINTF("click latency (us):\n");
+  adc_to_decision.print("ADC -> decision");
+  decision_to_dequeue.print("decision -> dequeue");
+  dequeue_to_input.print("dequeue -> input event");
+}
+
+void ClickLatency::printIfAny() const
+{
+  if (adc_to_decision.count() > 0 || decision_to_dequeue.count() > 0 ||
+      dequeue_to_input.count() > 0)
+  {
+    print();
+  }
+}
+
+ClickLatency* clickLatency()
+{
+  static ClickLatency* ret = new ClickLatency;
+  return ret;
+}
@@ -0,0 +1,66 @@
+#ifndef CLICKITONGUE_LATENCY_TRACKER_H_
+#define CLICKITONGUE_LATENCY_TRACKER_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include "constants.h"
+
+// The timebase of all latency stamps: nanoseconds on the steady clock.
+int64_t latencyNowNanos();
+
+// An action on its way from a Detector to the ActionDispatcher, stamped with
+// when the first sample of the audio block that triggered it hit the ADC, and
+// when the detector decided on it. Stamps are latencyNowNanos() values; 0
+// means unknown (e.g. replayed audio has no ADC time).
+struct TimedAction
+{
+  Action action = Action::NoAction;
+  int64_t adc_nanos = 0;
+  int64_t decision_nanos = 0;
+};
+
+// HDR-style histogram: 16 linear sub-buckets per power of two, so every
+// percentile is exact to within 1/16 of its value, in a fixed 8KB covering
+// the whole int64 range. One thread may record() while any others read.
+class LatencyHistogram
+{
+public:
+  void record(int64_t nanos);
+
+  int64_t count() const { return count_.load(std::memory_order_relaxed); }
+  int64_t maxNanos() const { return max_nanos_.load(std::memory_order_relaxed); }
+  // The (upper bound of the bucket holding the) pct'th percentile value.
+  int64_t percentileNanos(double pct) const;
+
+  // One line: count, mean, p50/p90/p99/p99.9 and max, in microseconds.
+  void print(const char* name) const;
+
+private:
+  static constexpr int kSubBucketBits = 4;
+  static constexpr int kNumBuckets = (64 - kSubBucketBits + 1) << kSubBucketBits;
+
+  std::atomic<uint64_t> buckets_[kNumBuckets] = {};
+  std::atomic<int64_t> count_{0};
+  std::atomic<int64_t> sum_nanos_{0};
+  std::atomic<int64_t> max_nanos_{0};
+};
+
+// Latency from the mic to the OS input event, split at each thread handoff.
+struct ClickLatency
+{
+  // ADC capture of the triggering block -> detector transition (the audio
+  // callback: PortAudio buffering, FFT, detectors).
+  LatencyHistogram adc_to_decision;
+  // Detector transition -> ActionDispatcher dequeue (waiting in the queue).
+  LatencyHistogram decision_to_dequeue;
+  // Dequeue -> mouse button event written (uinput, SendInput, or CGEventPost).
+  LatencyHistogram dequeue_to_input;
+
+  void print() const;
+  // For at exit: prints only if any clicks have been timed.
+  void printIfAny() const;
+};
+ClickLatency* clickLatency();
+
+#endif // CLICKITONGUE_LATENCY_TRACKER_H_
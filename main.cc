@@ -1,6 +1,8 @@
+#include <algorithm>
 #include <cstdio>
 #include <mutex>
 #include <thread>
+#include <utility>
 
 #include "action_dispatcher.h"
 #include "audio_input.h"
@@ -9,15 +11,31 @@
 #include "cat_detector.h"
 #include "cmdline_options.h"
 #include "constants.h"
+#include "dsp_thread.h"
 #include "easy_fourier.h"
 #include "fft_result_distributor.h"
 #include "hum_detector.h"
+#include "hum_scroll_detector.h"
 #include "interaction.h"
+#include "latency_tracker.h"
 #include "main_train.h"
+#include "replay.h"
+#include "telemetry.h"
 
 #include "config_io.h"
 
 int g_num_channels = 2;
+bool g_use_dsp_thread = false;
+int g_dsp_queue_blocks = 4;
+int g_fourier_blocksize = kDefaultFourierBlocksize;
+// What training gives each detector as its block size.
+int g_blow_blocksize = kDefaultFourierBlocksize;
+int g_cat_blocksize = kDefaultFourierBlocksize;
+int g_hum_blocksize = kDefaultFourierBlocksize;
+int g_fourier_hop = kDefaultFourierBlocksize;
+// --hop: what training gives each detector as its hop, if its block size is
+// at least that (else its block size).
+int g_max_fourier_hop = kMaxFourierBlocksize;
 
 // The Pa_Terminate() documentation is... menacing... about what happens if
 // every Pa_Initialize() call isn't matched before exiting. So let's be sure.
@@ -66,6 +84,7 @@ PaError deinitPulseAudio()
 }
 void makeSafeToExit()
 {
+  clickLatency()->printIfAny();
   const std::lock_guard<std::mutex> lock(g_pa_init_mutex);
   g_shutting_down = true;
   while (g_unresolved_pulseaudio_inits > 0)
@@ -146,19 +165,39 @@ void printDeviceDetails()
 
 void validateCmdlineOpts(ClickitongueCmdlineOpts opts)
 {
+  if (opts.dsp_queue_blocks.value() < 1 ||
+      opts.dsp_queue_blocks.value() > DspThread::kMaxQueueBlocks)
+  {
+    crash(("--dsp_queue_blocks must be between 1 and " +
+           std::to_string(DspThread::kMaxQueueBlocks) + ".").c_str());
+  }
+  for (auto [name, blocksize] : {std::make_pair("--blocksize", opts.blocksize),
+                                 std::make_pair("--blow_blocksize", opts.blow_blocksize),
+                                 std::make_pair("--cat_blocksize", opts.cat_blocksize),
+                                 std::make_pair("--hum_blocksize", opts.hum_blocksize)})
+  {
+    if (blocksize.has_value() && !isSupportedBlocksize(blocksize.value()))
+      crash((std::string(name) + " must be 128, 256, 512, or 1024.").c_str());
+  }
+  if (opts.hop.has_value() && !isSupportedHop(opts.hop.value(), kMaxFourierBlocksize))
+  {
+    crash(("--hop must be a power of 2, from " + std::to_string(kMinFourierHop) +
+           " to " + std::to_string(kMaxFourierBlocksize) + ".").c_str());
+  }
   if (!opts.mode.has_value())
     return;
   std::string mode = opts.mode.value();
-  if (mode != "record" && mode != "play" && mode != "equalizer" &&
-      mode != "spikes" && mode != "octaves" && mode != "overtones" &&
-      mode != "devdetails")
+  if (mode != "record" && mode != "play" && mode != "replay" &&
+      mode != "equalizer" && mode != "spikes" && mode != "octaves" &&
+      mode != "overtones" && mode != "devdetails")
   {
     crash("Invalid --mode= value. Must specify --mode=train, use, record,\n"
-          "play, equalizer, spikes, octaves, overtones, or devdetails.\n"
+          "play, replay, equalizer, spikes, octaves, overtones, or devdetails.\n"
           "(Or not specify it).");
   }
 
-  if ((mode == "record" || mode == "play") && !opts.filename.has_value())
+  if ((mode == "record" || mode == "play" || mode == "replay") &&
+      !opts.filename.has_value())
     crash("Must specify a --filename=");
 }
 
@@ -178,7 +217,9 @@ void describeLoadedParams(Config config, bool first_time)
            (config.cat.action_on == Action::RightDown ? "right" : "left") +
            " click.\n";
   }
-  if (config.hum.enabled && config.hum.action_on != Action::NoAction)
+  if (config.hum.enabled && config.hum.scroll)
+    msg += "Hum a rising or falling note to scroll up or down.\n";
+  else if (config.hum.enabled && config.hum.action_on != Action::NoAction)
   {
     msg += std::string("Hum to ") +
            (config.hum.action_on == Action::RightDown ? "right" : "left") +
@@ -199,7 +240,7 @@ void describeLoadedParams(Config config, bool first_time)
 }
 
 std::vector<std::unique_ptr<Detector>> makeDetectorsFromConfig(
-    Config config, BlockingQueue<Action>* action_queue)
+    Config config, ActionRing* action_queue)
 {
   std::unique_ptr<Detector> cat_detector;
   if (config.cat.enabled)
@@ -207,6 +248,7 @@ std::vector<std::unique_ptr<Detector>> makeDetectorsFromConfig(
     cat_detector = std::make_unique<CatDetector>(
         action_queue, config.cat.action_on, config.cat.action_off,
         config.cat.o7_on_thresh, config.cat.o1_limit, config.cat.use_limit);
+    cat_detector->setResolution(config.cat.fourier_blocksize, config.cat.fourier_hop);
     g_HACK_all_detectors.push_back(cat_detector.get());
   }
 
@@ -218,6 +260,7 @@ std::vector<std::unique_ptr<Detector>> makeDetectorsFromConfig(
         config.blow.o1_on_thresh, config.blow.o7_on_thresh,
         config.blow.o7_off_thresh, config.blow.lookback_blocks,
         /*require_warmup=*/config.cat.enabled);
+    blow_detector->setResolution(config.blow.fourier_blocksize, config.blow.fourier_hop);
     if (cat_detector)
     {
       blow_detector->addInhibitionTarget(cat_detector.get());
@@ -227,12 +270,23 @@ std::vector<std::unique_ptr<Detector>> makeDetectorsFromConfig(
   }
 
   std::unique_ptr<Detector> hum_detector;
-  if (config.hum.enabled)
+  if (config.hum.enabled && config.hum.scroll)
+  {
+    hum_detector = std::make_unique<HumScrollDetector>(
+        action_queue, config.hum.o1_on_thresh, config.hum.o1_off_thresh,
+        config.hum.o6_limit, config.hum.ewma_alpha,
+        /*require_warmup=*/config.blow.enabled);
+  }
+  else if (config.hum.enabled)
   {
     hum_detector = std::make_unique<HumDetector>(
         action_queue, config.hum.action_on, config.hum.action_off,
         config.hum.o1_on_thresh, config.hum.o1_off_thresh, config.hum.o6_limit,
         config.hum.ewma_alpha, /*require_warmup=*/config.blow.enabled);
+  }
+  if (hum_detector)
+  {
+    hum_detector->setResolution(config.hum.fourier_blocksize, config.hum.fourier_hop);
     if (blow_detector)
       blow_detector->addInhibitionTarget(hum_detector.get());
     if (cat_detector)
@@ -276,15 +330,34 @@ void normalOperation(Config config, bool first_time)
   {
     PRINTF("no mouse control configured - only voice-to-LLM is active.\n");
   }
+  if (config.fourier_blocksize != g_fourier_blocksize)
+  {
+    PRINTF("using the %d-frame blocks this config was trained at (not %d); "
+           "--retrain to change.\n", config.fourier_blocksize, g_fourier_blocksize);
+  }
+  g_fourier_blocksize = config.fourier_blocksize;
+  g_fourier_hop = g_fourier_blocksize;
 
-  BlockingQueue<Action> action_queue;
+  ActionRing action_queue;
   ActionDispatcher action_dispatcher(&action_queue);
   std::thread action_dispatch(actionDispatch, &action_dispatcher);
+  // (Create these lazy globals now, rather than in the audio callback).
+  telemetry();
+  clickLatency();
+  std::thread telemetry_logger(telemetryLogger);
+  telemetry_logger.detach();
 
   FFTResultDistributor fft_distributor(
       makeDetectorsFromConfig(config, &action_queue), loadScaleFromConfig(config),
       /*training=*/false);
-  AudioInput audio_input(fftDistributorCallback, &fft_distributor, kFourierBlocksize, kFramesPerSec, paFloat32, g_num_channels);
+  AudioWatchdog watchdog(&fft_distributor);
+  std::unique_ptr<DspThread> dsp_thread;
+  if (g_use_dsp_thread)
+    dsp_thread = std::make_unique<DspThread>(&fft_distributor, g_dsp_queue_blocks);
+  AudioInput audio_input(dsp_thread ? dspThreadCallback : fftDistributorCallback,
+                         dsp_thread ? (void*)dsp_thread.get() : &fft_distributor,
+                         fft_distributor.inputBlocksize(), kFramesPerSec,
+                         paFloat32, g_num_channels);
   describeLoadedParams(config, first_time);
 
   if (config.whisper_url.size() > 6)
@@ -304,6 +377,21 @@ void normalOperation(Config config, bool first_time)
   action_dispatch.join();
 }
 
+void replayMain(std::string filename, std::string config_name)
+{
+  std::optional<Config> config = readConfig(config_name);
+  if (!config.has_value())
+    crash(("Couldn't read config profile '" + config_name + "'.").c_str());
+
+  g_fourier_blocksize = config.value().fourier_blocksize;
+  g_fourier_hop = g_fourier_blocksize;
+  // Nothing dequeues from this; replay only logs the actions.
+  ActionRing action_queue;
+  replayRecording(AudioRecording(filename),
+                  makeDetectorsFromConfig(config.value(), &action_queue),
+                  loadScaleFromConfig(config.value()));
+}
+
 void defaultMain(bool ignore_existing_config)
 {
   std::string config_name = kDefaultConfig;
@@ -328,19 +416,34 @@ char* g_program_path = nullptr;
 #ifndef CLICKITONGUE_WINDOWS
 #include <csignal>
 volatile sig_atomic_t g_shutdown_flag = 0;
+volatile sig_atomic_t g_print_latency_flag = 0;
 void sigintHandler(int signal)
 {
   g_shutdown_flag = 1;
 }
+// kill -USR1 a running clickitongue to see its click latency so far.
+void sigusr1Handler(int signal)
+{
+  g_print_latency_flag = 1;
+}
 void signalWatcher()
 {
   while (g_shutdown_flag == 0)
+  {
     Pa_Sleep(200);
+    if (g_print_latency_flag)
+    {
+      g_print_latency_flag = 0;
+      clickLatency()->print();
+    }
+  }
   safelyExit(0);
 }
 #endif
 
 
+// (The benchmark build has its own main(), in benchmark.cc).
+#ifndef CLICKITONGUE_BENCH
 #ifdef CLICKITONGUE_WINDOWS
 #include "windows_gui.h"
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nCmdShow)
@@ -353,6 +456,7 @@ int main(int argc, char** argv)
   std::thread sigint_watcher_thread(signalWatcher);
   sigint_watcher_thread.detach();
   signal(SIGINT, sigintHandler);
+  signal(SIGUSR1, sigusr1Handler);
   opts = structopt::app("clickitongue", CLICKITONGUE_VERSION)
              .parse<ClickitongueCmdlineOpts>(argc, argv);
   validateCmdlineOpts(opts);
@@ -365,6 +469,14 @@ int main(int argc, char** argv)
 
   g_show_debug_info = opts.debug.value();
   g_forget_input_dev = opts.forget_input_dev.value();
+  g_use_dsp_thread = opts.dsp_thread.value();
+  g_dsp_queue_blocks = opts.dsp_queue_blocks.value();
+  g_fourier_blocksize = opts.blocksize.value_or(kDefaultFourierBlocksize);
+  g_blow_blocksize = opts.blow_blocksize.value_or(g_fourier_blocksize);
+  g_cat_blocksize = opts.cat_blocksize.value_or(g_fourier_blocksize);
+  g_hum_blocksize = opts.hum_blocksize.value_or(g_fourier_blocksize);
+  g_max_fourier_hop = opts.hop.value_or(kMaxFourierBlocksize);
+  g_fourier_hop = std::min(g_max_fourier_hop, g_fourier_blocksize);
   g_fourier = new EasyFourier();
 #ifdef CLICKITONGUE_LINUX
   g_program_path = realpath(argv[0], nullptr);
@@ -383,27 +495,29 @@ int main(int argc, char** argv)
       AudioRecording audio(opts.filename.value());
       audio.play();
     }
+    else if (opts.mode.value() == "replay")
+      replayMain(opts.filename.value(), opts.config.value_or(kDefaultConfig));
     else if (opts.mode.value() == "equalizer")
     {
-      AudioInput audio_input(equalizerCallback, nullptr, kFourierBlocksize, kFramesPerSec, paFloat32, g_num_channels);
+      AudioInput audio_input(equalizerCallback, nullptr, kDefaultFourierBlocksize, kFramesPerSec, paFloat32, g_num_channels);
       while (audio_input.active())
         Pa_Sleep(500);
     }
     else if (opts.mode.value() == "spikes")
     {
-      AudioInput audio_input(spikesCallback, nullptr, kFourierBlocksize, kFramesPerSec, paFloat32, g_num_channels);
+      AudioInput audio_input(spikesCallback, nullptr, kDefaultFourierBlocksize, kFramesPerSec, paFloat32, g_num_channels);
       while (audio_input.active())
         Pa_Sleep(500);
     }
     else if (opts.mode.value() == "octaves")
     {
-      AudioInput audio_input(octavesCallback, nullptr, kFourierBlocksize, kFramesPerSec, paFloat32, g_num_channels);
+      AudioInput audio_input(octavesCallback, nullptr, kDefaultFourierBlocksize, kFramesPerSec, paFloat32, g_num_channels);
       while (audio_input.active())
         Pa_Sleep(500);
     }
     else if (opts.mode.value() == "overtones")
     {
-      AudioInput audio_input(overtonesCallback, nullptr, kFourierBlocksize, kFramesPerSec, paFloat32, g_num_channels);
+      AudioInput audio_input(overtonesCallback, nullptr, kDefaultFourierBlocksize, kFramesPerSec, paFloat32, g_num_channels);
       while (audio_input.active())
         Pa_Sleep(500);
     }
@@ -424,3 +538,4 @@ int main(int argc, char** argv)
   makeSafeToExit();
   return 0;
 }
+#endif // CLICKITONGUE_BENCH
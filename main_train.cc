@@ -1,5 +1,6 @@
 #include "main_train.h"
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <unistd.h>
@@ -15,6 +16,29 @@
 
 using TaggedExamples = std::vector<std::pair<AudioRecording, int>>;
 
+extern int g_blow_blocksize;
+extern int g_cat_blocksize;
+extern int g_hum_blocksize;
+extern int g_max_fourier_hop;
+
+// Runs train() with g_fourier_blocksize temporarily set to blocksize (and
+// g_fourier_hop to its hop), so that the detector is trained on blocks of the
+// size and spacing it will run at.
+template<class TrainFn>
+auto trainAtBlocksize(int blocksize, TrainFn train)
+{
+  const int saved_blocksize = g_fourier_blocksize;
+  const int saved_hop = g_fourier_hop;
+  g_fourier_blocksize = blocksize;
+  g_fourier_hop = std::min(g_max_fourier_hop, blocksize);
+  auto detector_config = train();
+  detector_config.fourier_blocksize = g_fourier_blocksize;
+  detector_config.fourier_hop = g_fourier_hop;
+  g_fourier_blocksize = saved_blocksize;
+  g_fourier_hop = saved_hop;
+  return detector_config;
+}
+
 bool introAndAskIfMicNearMouth()
 {
   bool mic_near_mouth = promptYesNo(
@@ -148,6 +172,7 @@ void trainingBody(TaggedExamples* blow_examples, TaggedExamples* cat_examples,
       hum_examples, {blow_examples, cat_examples});
 
   Config config;
+  config.fourier_blocksize = g_fourier_blocksize;
 
   if (want_normal_clickitongue)
   {
@@ -156,11 +181,20 @@ void trainingBody(TaggedExamples* blow_examples, TaggedExamples* cat_examples,
 
     unlink("clickitongue_training.log");
     if (!blow_examples_plus_neg.empty())
-      config.blow = trainBlow(blow_examples_plus_neg, scale, mic_near_mouth);
+    {
+      config.blow = trainAtBlocksize(g_blow_blocksize, [&]()
+          { return trainBlow(blow_examples_plus_neg, scale, mic_near_mouth); });
+    }
     if (!cat_examples_plus_neg.empty())
-      config.cat = trainCat(cat_examples_plus_neg, scale, mic_near_mouth);
+    {
+      config.cat = trainAtBlocksize(g_cat_blocksize, [&]()
+          { return trainCat(cat_examples_plus_neg, scale, mic_near_mouth); });
+    }
     if (!hum_examples_plus_neg.empty())
-      config.hum = trainHum(hum_examples_plus_neg, scale, mic_near_mouth);
+    {
+      config.hum = trainAtBlocksize(g_hum_blocksize, [&]()
+          { return trainHum(hum_examples_plus_neg, scale, mic_near_mouth); });
+    }
   }
 
   std::string failure_list;
@@ -295,6 +329,7 @@ bool afterTraining(Config* config, int success_count,
   assert(!want_voice_llm);
 #endif
 
+  keepHandWrittenSettings(config, kDefaultConfig);
   std::string attempted_filepath;
   if (!writeConfig(*config, kDefaultConfig, &attempted_filepath))
   {
@@ -0,0 +1,142 @@
+#include "pitch_tracker.h"
+
+#include <cmath>
+#include <utility>
+
+namespace {
+
+// A clear pitch's peak (its bin and the two beside it) has at least this
+// fraction of all the power in [kMinHz, kMaxHz].
+constexpr double kMinPeakFraction = 0.2;
+// A hum's second harmonic can outweigh its fundamental. So, if there's a peak
+// at half the frequency with at least this fraction of the power, that's the
+// pitch.
+constexpr double kSubharmonicRatio = 0.3;
+
+std::complex<double> mul(std::complex<double> a, std::complex<double> b)
+{
+  return {a.real() * b.real() - a.imag() * b.imag(),
+          a.real() * b.imag() + a.imag() * b.real()};
+}
+
+// In-place iterative radix-2 FFT; twiddle[j] = e^(-2 pi i j/n).
+void fftInPlace(std::complex<double>* x, int n, const std::complex<double>* twiddle)
+{
+  for (int i = 1, j = 0; i < n; i++)
+  {
+    int bit = n >> 1;
+    for (; j & bit; bit >>= 1)
+      j ^= bit;
+    j |= bit;
+    if (i < j)
+      std::swap(x[i], x[j]);
+  }
+  for (int len = 2; len <= n; len <<= 1)
+  {
+    const int stride = n / len;
+    for (int start = 0; start < n; start += len)
+    {
+      for (int k = 0; k < len / 2; k++)
+      {
+        const std::complex<double> even = x[start + k];
+        const std::complex<double> odd = mul(x[start + k + len/2], twiddle[k * stride]);
+        x[start + k] = even + odd;
+        x[start + k + len/2] = even - odd;
+      }
+    }
+  }
+}
+
+} // namespace
+
+ZoomPitchTracker::ZoomPitchTracker()
+{
+  const double two_pi = 2.0 * std::acos(-1.0);
+  step_re_ = std::cos(two_pi * kCenterHz / kFramesPerSec);
+  step_im_ = -std::sin(two_pi * kCenterHz / kFramesPerSec);
+  for (int m = 0; m < kZoomSize; m++)
+    window_[m] = 0.5 - 0.5 * std::cos(two_pi * m / kZoomSize); // Hann
+  for (int j = 0; j < kZoomSize / 2; j++)
+    twiddle_[j] = std::polar(1.0, -two_pi * j / kZoomSize);
+  low_bin_ = (int)std::ceil((kMinHz - kCenterHz) / kZoomBinWidth);
+  high_bin_ = (int)std::floor((kMaxHz - kCenterHz) / kZoomBinWidth);
+}
+
+double ZoomPitchTracker::process(const FourierReal* mono, int num_frames)
+{
+  for (int i = 0; i < num_frames; i++)
+  {
+    const double mixed_re = mono[i] * phasor_re_;
+    const double mixed_im = mono[i] * phasor_im_;
+    const double next_re = phasor_re_ * step_re_ - phasor_im_ * step_im_;
+    phasor_im_ = phasor_re_ * step_im_ + phasor_im_ * step_re_;
+    phasor_re_ = next_re;
+
+    const double rise = phase_ + 1;
+    const double fall = kDecimation - phase_;
+    rising_re_ += mixed_re * rise;
+    rising_im_ += mixed_im * rise;
+    falling_re_ += mixed_re * fall;
+    falling_im_ += mixed_im * fall;
+    if (++phase_ == kDecimation)
+    {
+      // (Unnormalized; only relative powers matter).
+      decimated_[next_] = {prev_rising_re_ + falling_re_, prev_rising_im_ + falling_im_};
+      next_ = (next_ + 1) % kZoomSize;
+      prev_rising_re_ = rising_re_;
+      prev_rising_im_ = rising_im_;
+      rising_re_ = rising_im_ = falling_re_ = falling_im_ = 0;
+      phase_ = 0;
+    }
+  }
+  // Keep rounding error from drifting the phasor's magnitude away from 1.
+  const double magnitude = std::sqrt(phasor_re_ * phasor_re_ + phasor_im_ * phasor_im_);
+  phasor_re_ /= magnitude;
+  phasor_im_ /= magnitude;
+
+  return estimatePitch();
+}
+
+double ZoomPitchTracker::estimatePitch()
+{
+  for (int m = 0; m < kZoomSize; m++)
+    fft_[m] = decimated_[(next_ + m) % kZoomSize] * window_[m];
+  fftInPlace(fft_, kZoomSize, twiddle_);
+
+  int peak = low_bin_;
+  double total = 0;
+  for (int k = low_bin_; k <= high_bin_; k++)
+  {
+    total += binPower(k);
+    if (binPower(k) > binPower(peak))
+      peak = k;
+  }
+  const double peak_power = binPower(peak - 1) + binPower(peak) + binPower(peak + 1);
+  if (total <= 0 || peak_power < kMinPeakFraction * total)
+    return 0;
+
+  double hz = peakHz(peak);
+  if (hz / 2 >= kMinHz)
+  {
+    const int half = (int)std::lround((hz / 2 - kCenterHz) / kZoomBinWidth);
+    int sub = half;
+    for (int k = half - 1; k <= half + 1; k++)
+      if (k >= low_bin_ && binPower(k) > binPower(sub))
+        sub = k;
+    if (sub >= low_bin_ && binPower(sub) >= kSubharmonicRatio * binPower(peak))
+      hz = peakHz(sub);
+  }
+  return hz;
+}
+
+double ZoomPitchTracker::peakHz(int k) const
+{
+  // Parabolic interpolation of log power, which is close to exact for the
+  // Hann window's (near-Gaussian) main lobe.
+  const double below = std::log(binPower(k - 1) + 1e-300);
+  const double at = std::log(binPower(k) + 1e-300);
+  const double above = std::log(binPower(k + 1) + 1e-300);
+  const double denom = below - 2 * at + above;
+  const double offset = denom < 0 ? 0.5 * (below - above) / denom : 0;
+  return kCenterHz + (k + offset) * kZoomBinWidth;
+}
@@ -0,0 +1,73 @@
+#ifndef CLICKITONGUE_PITCH_TRACKER_H_
+#define CLICKITONGUE_PITCH_TRACKER_H_
+
+#include <complex>
+
+#include "constants.h"
+#include "easy_fourier.h"
+
+// Tracks the pitch of a hum to a fraction of a Hz, via a zoom FFT: rather
+// than an FFT long enough to resolve a few Hz at the full sample rate (tens of
+// thousands of points), shift the hum band down to around 0 Hz, low-pass and
+// decimate by kDecimation, and take a small complex FFT of what's left. Per
+// block that's a few multiply-adds per sample, plus one kZoomSize-point FFT.
+//
+// Each estimate covers the last kZoomSize decimated samples (~190ms).
+class ZoomPitchTracker
+{
+public:
+  // Pitches are only looked for in [kMinHz, kMaxHz].
+  static constexpr double kMinHz = 70;
+  static constexpr double kMaxHz = 420;
+
+  ZoomPitchTracker();
+
+  // mono: the next num_frames frames of (downmixed) audio. Returns the pitch,
+  // in Hz, of the most recent window; or 0 if there's no clear one.
+  double process(const FourierReal* mono, int num_frames);
+
+private:
+  static constexpr int kDecimation = 64;
+  static constexpr int kZoomSize = 128; // must be a power of 2
+  static constexpr double kDecimatedRate = (double)kFramesPerSec / kDecimation;
+  static constexpr double kZoomBinWidth = kDecimatedRate / kZoomSize;
+  // What gets shifted down to 0 Hz: the middle of [kMinHz, kMaxHz].
+  static constexpr double kCenterHz = (kMinHz + kMaxHz) / 2;
+
+  double estimatePitch();
+  // Power of zoom bin k, which may be negative (below kCenterHz).
+  double binPower(int k) const { return std::norm(fft_[(k + kZoomSize) % kZoomSize]); }
+  // The frequency of the power peak around zoom bin k, interpolated.
+  double peakHz(int k) const;
+
+  // (The per-sample state is plain doubles, rather than std::complex, whose
+  // multiply is an out-of-line NaN-handling call without -ffast-math).
+
+  // e^(-2 pi i kCenterHz t) at the current sample, and its per-sample step.
+  double phasor_re_ = 1;
+  double phasor_im_ = 0;
+  double step_re_;
+  double step_im_;
+
+  // Low-pass and decimation: each decimated sample is a triangle-weighted sum
+  // (weights 1..D, then D..1) of the 2D mixed samples leading up to it. So,
+  // each sample goes into the rising half of the next decimated sample, and
+  // the falling half of the current one.
+  double rising_re_ = 0, rising_im_ = 0;
+  double falling_re_ = 0, falling_im_ = 0;
+  double prev_rising_re_ = 0, prev_rising_im_ = 0;
+  int phase_ = 0; // position within the current kDecimation samples
+
+  // The last kZoomSize decimated samples; the oldest is decimated_[next_].
+  std::complex<double> decimated_[kZoomSize];
+  int next_ = 0;
+
+  // The zoom bins [low_bin_, high_bin_] lie within [kMinHz, kMaxHz].
+  int low_bin_;
+  int high_bin_;
+  double window_[kZoomSize];
+  std::complex<double> twiddle_[kZoomSize / 2];
+  std::complex<double> fft_[kZoomSize];
+};
+
+#endif // CLICKITONGUE_PITCH_TRACKER_H_
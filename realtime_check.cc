@@ -0,0 +1,37 @@
+#ifdef CLICKITONGUE_RT_CHECKS
+
+#include "realtime_check.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+thread_local int t_realtime_depth = 0;
+
+void* checkedAlloc(std::size_t size)
+{
+  if (t_realtime_depth > 0)
+  {
+    fputs("heap allocation inside a RealtimeScope (the audio callback)!\n", stderr);
+    abort();
+  }
+  if (void* ret = malloc(size ? size : 1))
+    return ret;
+  throw std::bad_alloc();
+}
+
+} // namespace
+
+RealtimeScope::RealtimeScope() { t_realtime_depth++; }
+RealtimeScope::~RealtimeScope() { t_realtime_depth--; }
+
+void* operator new(std::size_t size) { return checkedAlloc(size); }
+void* operator new[](std::size_t size) { return checkedAlloc(size); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, std::size_t) noexcept { free(p); }
+void operator delete[](void* p, std::size_t) noexcept { free(p); }
+
+#endif // CLICKITONGUE_RT_CHECKS
@@ -0,0 +1,21 @@
+#ifndef CLICKITONGUE_REALTIME_CHECK_H_
+#define CLICKITONGUE_REALTIME_CHECK_H_
+
+// Marks the current thread as being on a real-time path (the audio callback)
+// for this object's lifetime. Built with -DCLICKITONGUE_RT_CHECKS, any heap
+// allocation on that path aborts the program, naming the culprit in a
+// debugger's backtrace - so violations turn up in testing rather than as
+// occasional xruns. Without the flag, this compiles to nothing.
+class RealtimeScope
+{
+public:
+#ifdef CLICKITONGUE_RT_CHECKS
+  RealtimeScope();
+  ~RealtimeScope();
+#else
+  RealtimeScope() {}
+  ~RealtimeScope() {}
+#endif
+};
+
+#endif // CLICKITONGUE_REALTIME_CHECK_H_
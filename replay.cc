@@ -0,0 +1,70 @@
+#include "replay.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "config_io.h"
+#include "fft_result_distributor.h"
+#include "interaction.h"
+
+namespace {
+
+double percentileMicros(std::vector<int64_t> const& sorted_nanos, double pct)
+{
+  int ind = std::min((int)(pct / 100.0 * sorted_nanos.size()),
+                     (int)sorted_nanos.size() - 1);
+  return sorted_nanos[ind] / 1000.0;
+}
+
+} // namespace
+
+void replayRecording(AudioRecording const& recording,
+                     std::vector<std::unique_ptr<Detector>>&& detectors,
+                     double scale)
+{
+  std::vector<std::pair<int, Action>> events;
+  for (auto& detector : detectors)
+    detector->setEventLog(&events);
+  FFTResultDistributor distributor(std::move(detectors), scale,
+                                   /*training=*/true);
+
+  std::vector<float> const& samples = recording.samples();
+  const int input_blocksize = distributor.inputBlocksize();
+  const int block_len = input_blocksize * g_num_channels;
+  std::vector<int64_t> block_nanos;
+  block_nanos.reserve(samples.size() / block_len);
+
+  auto start = std::chrono::steady_clock::now();
+  for (int sample_ind = 0; sample_ind + block_len <= samples.size();
+       sample_ind += block_len)
+  {
+    auto block_start = std::chrono::steady_clock::now();
+    distributor.processAudio(samples.data() + sample_ind, input_blocksize);
+    auto block_end = std::chrono::steady_clock::now();
+    block_nanos.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        block_end - block_start).count());
+  }
+  double elapsed_secs = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+
+  for (auto const& [frame, action] : events)
+  {
+    PRINTF("frame %d (%.3f s): %s\n", frame, frame / (double)kFramesPerSec,
+           actionString(action).c_str());
+  }
+  if (block_nanos.empty())
+  {
+    PRINTF("recording was shorter than one block; nothing replayed.\n");
+    return;
+  }
+  std::sort(block_nanos.begin(), block_nanos.end());
+  double audio_secs = block_nanos.size() * input_blocksize / (double)kFramesPerSec;
+  PRINTF("replayed %d blocks (%.2f s of audio) in %.3f s: %.0f blocks/s, "
+         "%.1fx realtime\n", (int)block_nanos.size(), audio_secs, elapsed_secs,
+         block_nanos.size() / elapsed_secs, audio_secs / elapsed_secs);
+  PRINTF("per-block latency (us): p50 %.2f  p90 %.2f  p99 %.2f  p99.9 %.2f  "
+         "max %.2f\n",
+         percentileMicros(block_nanos, 50), percentileMicros(block_nanos, 90),
+         percentileMicros(block_nanos, 99), percentileMicros(block_nanos, 99.9),
+         block_nanos.back() / 1000.0);
+}
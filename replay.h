@@ -0,0 +1,20 @@
+#ifndef CLICKITONGUE_REPLAY_H_
+#define CLICKITONGUE_REPLAY_H_
+
+#include <memory>
+#include <vector>
+
+#include "audio_recording.h"
+#include "detector.h"
+#include "fft_result_distributor.h"
+
+// Feeds recording through an FFTResultDistributor running detectors, as fast
+// as the CPU allows rather than at the audio's real rate. Prints the frame
+// index of every action the detectors kick off, then the throughput in blocks
+// per second and percentiles of the time each block took to process.
+// (The actions are only logged; nothing is clicked).
+void replayRecording(AudioRecording const& recording,
+                     std::vector<std::unique_ptr<Detector>>&& detectors,
+                     double scale);
+
+#endif // CLICKITONGUE_REPLAY_H_
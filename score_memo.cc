@@ -0,0 +1,28 @@
+#include "score_memo.h"
+
+#include <functional>
+
+std::optional<std::vector<int>> ScoreMemo::find(ScoreMemoKey const& key)
+{
+  lookups_.fetch_add(1, std::memory_order_relaxed);
+  const std::lock_guard<std::mutex> lock(mutex_);
+  auto it = scores_.find(key);
+  if (it == scores_.end())
+    return std::nullopt;
+  hits_.fetch_add(1, std::memory_order_relaxed);
+  return it->second;
+}
+
+void ScoreMemo::insert(ScoreMemoKey const& key, std::vector<int> const& score)
+{
+  const std::lock_guard<std::mutex> lock(mutex_);
+  scores_.emplace(key, score);
+}
+
+size_t ScoreMemo::KeyHash::operator()(ScoreMemoKey const& key) const
+{
+  size_t ret = 0;
+  for (int64_t x : key)
+    ret = ret * 1000003 ^ std::hash<int64_t>()(x);
+  return ret;
+}
@@ -0,0 +1,49 @@
+#ifndef CLICKITONGUE_SCORE_MEMO_H_
+#define CLICKITONGUE_SCORE_MEMO_H_
+
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+// A training candidate's parameters, quantized (see quantizeParam()); unused
+// trailing slots are 0.
+using ScoreMemoKey = std::array<int64_t, 4>;
+
+// Rounds a parameter to a grid much finer than any difference that could
+// change a detector's behaviour, but coarse enough that the same point
+// reached by different arithmetic (e.g. x - step + step, or a clamp to the
+// same bound) lands on the same key.
+inline int64_t quantizeParam(double x) { return (int64_t)std::llround(x * 1e9); }
+
+// Training's score vectors, by candidate: pattern search keeps revisiting
+// points it has already scored (neighbours of neighbours, clamped edge
+// points, tuning's re-scores), and a score never changes for the same corpus.
+// Safe to use from any number of threads. Only full scores go in; never one
+// cut short by a ScoreCutoff.
+class ScoreMemo
+{
+public:
+  std::optional<std::vector<int>> find(ScoreMemoKey const& key);
+  void insert(ScoreMemoKey const& key, std::vector<int> const& score);
+
+  uint64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+  uint64_t lookups() const { return lookups_.load(std::memory_order_relaxed); }
+
+private:
+  struct KeyHash
+  {
+    size_t operator()(ScoreMemoKey const& key) const;
+  };
+
+  std::mutex mutex_;
+  std::unordered_map<ScoreMemoKey, std::vector<int>, KeyHash> scores_;
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> lookups_{0};
+};
+
+#endif // CLICKITONGUE_SCORE_MEMO_H_
@@ -0,0 +1,19 @@
+#ifdef CLICKITONGUE_BENCH
+
+#include "sliding_dft.h"
+
+#include "band_features.h"
+
+std::vector<int> binsOfOctaves(int blocksize, std::vector<int> const& octaves)
+{
+  std::vector<int> bins;
+  for (int k : octaves)
+  {
+    BinRange range = octaveBins(blocksize, k);
+    for (int bin = range.begin; bin < range.end; bin++)
+      bins.push_back(bin);
+  }
+  return bins;
+}
+
+#endif // CLICKITONGUE_BENCH
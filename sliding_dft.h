@@ -0,0 +1,138 @@
+#ifndef CLICKITONGUE_SLIDING_DFT_H_
+#define CLICKITONGUE_SLIDING_DFT_H_
+#ifdef CLICKITONGUE_BENCH
+
+#include <cmath>
+#include <vector>
+
+#include "constants.h"
+#include "easy_fourier.h"
+
+// A bank of sliding DFTs over the last kBlocksize samples of (downmixed)
+// audio, for just the bins asked for. Each sample updates each tracked bin in
+// O(1), via X_k(n) = e^(2 pi i k/N) * (X_k(n-1) - x[n-N] + x[n]), so power()
+// is valid after any sample, not only at block boundaries.
+//
+// Versus a kBlocksize FFT: at a block boundary, the same power (up to
+// rounding) in the tracked bins. But that's O(N) work per bin per block,
+// against FFTW's O(N log N) for every bin at once - so it only comes out ahead
+// when very few bins are wanted, far fewer than the detectors read. So it's
+// only built (with CLICKITONGUE_BENCH) as a point of comparison for
+// benchmark.cc.
+template<int kBlocksize>
+class SlidingDft
+{
+public:
+  static constexpr int kNumBins = kBlocksize/2 + 1;
+
+  // bins: indices into the kNumBins bins of a kBlocksize FFT.
+  explicit SlidingDft(std::vector<int> const& bins)
+    : bins_(bins), re_(bins_.size(), 0), im_(bins_.size(), 0),
+      rot_re_(bins_.size()), rot_im_(bins_.size())
+  {
+    const double two_pi = 2.0 * std::acos(-1.0);
+    for (int j = 0; j < kBlocksize; j++)
+    {
+      cos_[j] = std::cos(two_pi * j / kBlocksize);
+      sin_[j] = std::sin(two_pi * j / kBlocksize);
+    }
+    for (int b = 0; b < bins_.size(); b++)
+    {
+      rot_re_[b] = cos_[bins_[b]];
+      rot_im_[b] = sin_[bins_[b]];
+    }
+  }
+
+  // Slides the window along num_frames frames of interleaved kChannels audio,
+  // downmixed exactly as the FFT pipeline does.
+  template<int kChannels>
+  void push(const Sample* frames, int num_frames)
+  {
+    static_assert(kChannels == 1 || kChannels == 2);
+    for (const Sample* f = frames; f < frames + kChannels*num_frames; f += kChannels)
+    {
+      if constexpr (kChannels == 2)
+        pushSample((f[0] + f[1]) / (FourierReal)2);
+      else
+        pushSample((FourierReal)f[0]);
+    }
+  }
+
+  // For each of the bins asked for, out[k][0] = scale * |X_k|^2 of the last
+  // kBlocksize samples, like the FFT pipeline. Every other out[k][0] (of
+  // kNumBins) is 0.
+  void power(FourierComplex* out, double scale) const
+  {
+    for (int k = 0; k < kNumBins; k++)
+      out[k][0] = 0;
+    for (int b = 0; b < bins_.size(); b++)
+      out[bins_[b]][0] = scale * (re_[b] * re_[b] + im_[b] * im_[b]);
+  }
+
+private:
+  void pushSample(double x)
+  {
+    const double delta = x - history_[next_];
+    history_[next_] = x;
+    next_ = (next_ + 1) % kBlocksize;
+
+    const int num_bins = bins_.size();
+    double* re = re_.data();
+    double* im = im_.data();
+    const double* rot_re = rot_re_.data();
+    const double* rot_im = rot_im_.data();
+    for (int b = 0; b < num_bins; b++)
+    {
+      const double r = re[b] + delta;
+      const double i = im[b];
+      re[b] = r * rot_re[b] - i * rot_im[b];
+      im[b] = r * rot_im[b] + i * rot_re[b];
+    }
+
+    if (++samples_since_resync_ == kResyncSamples)
+      resync();
+  }
+
+  // Recomputes the state directly from history_, discarding the rounding
+  // error that the recurrence (which never forgets) would otherwise pile up.
+  void resync()
+  {
+    samples_since_resync_ = 0;
+    for (int b = 0; b < bins_.size(); b++)
+    {
+      // X_k = sum over the window (oldest first) of x[m] * e^(-2 pi i k m/N).
+      double re = 0;
+      double im = 0;
+      for (int m = 0; m < kBlocksize; m++)
+      {
+        const double x = history_[(next_ + m) % kBlocksize];
+        const int j = (bins_[b] * m) % kBlocksize;
+        re += x * cos_[j];
+        im -= x * sin_[j];
+      }
+      re_[b] = re;
+      im_[b] = im;
+    }
+  }
+
+  // Roughly every 6 seconds of audio; each resync costs about as much as one
+  // block's worth of updates.
+  static constexpr int kResyncSamples = kDefaultFourierBlocksize * 1024;
+
+  const std::vector<int> bins_;
+  // Per tracked bin: X_k, and the e^(2 pi i k/N) it's rotated by every sample.
+  std::vector<double> re_, im_, rot_re_, rot_im_;
+  // cos and sin of 2 pi j/N, for resync().
+  double cos_[kBlocksize];
+  double sin_[kBlocksize];
+  // The last kBlocksize samples; the oldest is history_[next_].
+  double history_[kBlocksize] = {0};
+  int next_ = 0;
+  int samples_since_resync_ = 0;
+};
+
+// The bins making up the given octaves (see octaveBins()) at this block size.
+std::vector<int> binsOfOctaves(int blocksize, std::vector<int> const& octaves);
+
+#endif // CLICKITONGUE_BENCH
+#endif // CLICKITONGUE_SLIDING_DFT_H_
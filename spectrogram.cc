@@ -0,0 +1,109 @@
+#include "spectrogram.h"
+
+#include "spectrum_pipeline.h"
+
+namespace {
+
+// Calls process(block) with each of a Spectrogram's blocks of samples, plus
+// trailing_blocks more past the end, in order.
+template<class Process>
+void forEachBlock(std::vector<Sample> const& samples, int num_channels,
+                  int trailing_blocks, Process process)
+{
+  const int block_len = g_fourier_blocksize * num_channels;
+  const int hop_len = g_fourier_hop * num_channels;
+
+  // Overlapping blocks start out reaching back before the recording, into
+  // what FFTResultDistributor's history starts out as: silence. (And trailing
+  // blocks reach forward into more of it).
+  std::vector<Sample> padded;
+  const Sample* start = samples.data();
+  if (hop_len < block_len || trailing_blocks > 0)
+  {
+    padded.assign(block_len - hop_len, kSilentSample);
+    padded.insert(padded.end(), samples.begin(), samples.end());
+    padded.resize(padded.size() + trailing_blocks * hop_len, kSilentSample);
+    start = padded.data();
+  }
+  // (Block i ends hop_len * (i+1) samples into the recording).
+  const int end_limit = samples.size() + trailing_blocks * hop_len;
+  for (int end_ind = hop_len; end_ind < end_limit; end_ind += hop_len)
+    process(start + end_ind - hop_len);
+}
+
+SpectrumPipelineOptions spectrogramOptions()
+{
+  SpectrumPipelineOptions options;
+  options.hop = g_fourier_hop;
+  return options;
+}
+
+} // namespace
+
+Spectrogram::Spectrogram(std::vector<Sample> const& samples, int num_channels,
+                         double scale)
+{
+  std::unique_ptr<SpectrumPipeline> pipeline = makeSpectrumPipeline(
+      g_fourier_blocksize, num_channels, scale, spectrogramOptions());
+  forEachBlock(samples, num_channels, 0, [&](const Sample* block)
+  {
+    blocks_.push_back(pipeline->process(block));
+  });
+}
+
+Spectrogram::Spectrogram(ComplexSpectrogram const& spectra, double scale,
+                         double gain, ComplexSpectrogram const* noise)
+{
+  // (Downmixing came before the spectra, so the channel count is moot here).
+  std::unique_ptr<SpectrumPipeline> pipeline = makeSpectrumPipeline(
+      g_fourier_blocksize, 1, scale, spectrogramOptions());
+  const int num_reals = 2 * spectra.numBins();
+  std::vector<FourierReal> mixed(num_reals);
+  for (int i = 0; i < spectra.numBlocks(); i++)
+  {
+    const FourierReal* x = spectra.block(i)[0];
+    const FourierReal* n =
+        noise && i < noise->numBlocks() ? noise->block(i)[0] : nullptr;
+    if (gain == 1.0 && !n)
+    {
+      blocks_.push_back(pipeline->processSpectrum(spectra.block(i)));
+      continue;
+    }
+    for (int j = 0; j < num_reals; j++)
+      mixed[j] = gain * x[j] + (n ? n[j] : 0);
+    blocks_.push_back(pipeline->processSpectrum(
+        reinterpret_cast<const FourierComplex*>(mixed.data())));
+  }
+}
+
+int Spectrogram::numBlocks() const { return blocks_.size(); }
+
+BandFeatures const& Spectrogram::block(int index) const
+{
+  return blocks_[index];
+}
+
+ComplexSpectrogram::ComplexSpectrogram(std::vector<Sample> const& samples,
+                                       int num_channels, int trailing_blocks)
+  : num_bins_(g_fourier_blocksize / 2 + 1)
+{
+  std::unique_ptr<SpectrumPipeline> pipeline = makeSpectrumPipeline(
+      g_fourier_blocksize, num_channels, 1.0, spectrogramOptions());
+  bins_.reserve((samples.size() / (g_fourier_hop * num_channels) + trailing_blocks) *
+                2 * num_bins_);
+  forEachBlock(samples, num_channels, trailing_blocks, [&](const Sample* block)
+  {
+    bins_.resize(bins_.size() + 2 * num_bins_);
+    pipeline->spectrum(block, reinterpret_cast<FourierComplex*>(
+                                  bins_.data() + bins_.size() - 2 * num_bins_));
+  });
+}
+
+int ComplexSpectrogram::numBlocks() const { return bins_.size() / (2 * num_bins_); }
+
+int ComplexSpectrogram::numBins() const { return num_bins_; }
+
+const FourierComplex* ComplexSpectrogram::block(int index) const
+{
+  return reinterpret_cast<const FourierComplex*>(bins_.data() + 2 * num_bins_ * index);
+}
@@ -0,0 +1,68 @@
+#ifndef CLICKITONGUE_SPECTROGRAM_H_
+#define CLICKITONGUE_SPECTROGRAM_H_
+
+#include <vector>
+
+#include "band_features.h"
+#include "constants.h"
+#include "easy_fourier.h"
+
+class ComplexSpectrogram;
+
+// The per-block BandFeatures of an entire recording, computed once up front.
+// Training scores many candidate parameter sets against the same audio, so
+// rather than re-running FFTs for every candidate, it replays detectors over
+// one of these.
+class Spectrogram
+{
+public:
+  // samples: interleaved num_channels audio. Produces exactly the blocks
+  // that feeding samples through FFTResultDistributor::processAudio() one
+  // g_fourier_hop chunk at a time would have produced, at g_fourier_blocksize.
+  // (Or, for mono samples, what the same audio in stereo would have).
+  Spectrogram(std::vector<Sample> const& samples, int num_channels, double scale);
+
+  // The Spectrogram of spectra's recording with its samples multiplied by
+  // gain, and (if given) noise's recording added on, aligned at the start:
+  // the same as AudioRecording's scale() and +=, done to the spectra instead.
+  // (Past the end of the noise, nothing is added).
+  Spectrogram(ComplexSpectrogram const& spectra, double scale, double gain = 1.0,
+              ComplexSpectrogram const* noise = nullptr);
+
+  int numBlocks() const;
+
+  // What FFTResultDistributor would have handed the detectors for block i.
+  BandFeatures const& block(int index) const;
+
+private:
+  std::vector<BandFeatures> blocks_;
+};
+
+// The per-block complex spectra of a recording, as blocked and windowed for a
+// Spectrogram. The FFT is linear, so a louder, quieter, or noise-added copy
+// of the recording has spectra g*X (+ N): training derives all its augmented
+// example sets from one of these per base recording and per noise, rather
+// than re-running FFTs over a copy of the audio for each.
+class ComplexSpectrogram
+{
+public:
+  // As Spectrogram's, except that trailing_blocks further blocks (reaching
+  // past the end of the recording, into silence) are included. That's for
+  // noise, whose last bits of audio can land in such a block of a longer
+  // recording.
+  ComplexSpectrogram(std::vector<Sample> const& samples, int num_channels,
+                     int trailing_blocks = 0);
+
+  int numBlocks() const;
+  int numBins() const;
+
+  // numBins() bins.
+  const FourierComplex* block(int index) const;
+
+private:
+  int num_bins_;
+  // Flat rather than a vector per block: one allocation per recording.
+  std::vector<FourierReal> bins_;
+};
+
+#endif // CLICKITONGUE_SPECTROGRAM_H_
@@ -0,0 +1,134 @@
+#include "spectrum_pipeline.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "dsp_kernels.h"
+#include "easy_fourier.h"
+#include "pitch_tracker.h"
+
+void crash(const char* s);
+
+namespace {
+
+// 1 / the mean square of a Hann window.
+constexpr double kHannPowerGain = 8.0 / 3.0;
+
+constexpr double powerNormalization(int blocksize, int hop)
+{
+  const double ratio = (double)kDefaultFourierBlocksize / blocksize;
+  return ratio * ratio * (hop < blocksize ? kHannPowerGain : 1.0);
+}
+
+template<int kBlocksize, int kChannels>
+class FFTPipeline : public SpectrumPipeline
+{
+public:
+  FFTPipeline(double scale, int hop, SpectrumPipelineOptions const& options)
+    : owned_lease_(options.shared_lease ? nullptr
+                                        : new FourierLease(g_fourier->borrowWorker())),
+      lease_(options.shared_lease ? options.shared_lease : owned_lease_.get()),
+      hop_(hop), scale_(scale * powerNormalization(kBlocksize, hop)),
+      pitch_tracker_(options.track_pitch ? std::make_unique<ZoomPitchTracker>()
+                                         : nullptr),
+      band_features_(hop)
+  {
+    const double two_pi = 2.0 * std::acos(-1.0);
+    for (int i = 0; i < kBlocksize; i++)
+      window_[i] = 0.5 - 0.5 * std::cos(two_pi * i / kBlocksize);
+  }
+
+  BandFeatures const& process(const Sample* frames) override
+  {
+    loadMono(frames);
+    const double pitch_hz = pitch_tracker_
+        ? pitch_tracker_->process(lease_->in + kBlocksize - hop_, hop_) : 0;
+    windowAndFFT();
+    return featuresOfOut(pitch_hz);
+  }
+  void spectrum(const Sample* frames, FourierComplex* out) override
+  {
+    loadMono(frames);
+    windowAndFFT();
+    std::memcpy(out, lease_->out, kNumBins * sizeof(FourierComplex));
+  }
+  BandFeatures const& processSpectrum(const FourierComplex* bins) override
+  {
+    std::memcpy(lease_->out, bins, kNumBins * sizeof(FourierComplex));
+    return featuresOfOut(0);
+  }
+  int blocksize() const override { return kBlocksize; }
+  int hop() const override { return hop_; }
+
+private:
+  static constexpr int kNumBins = kBlocksize/2 + 1;
+
+  void loadMono(const Sample* frames)
+  {
+    if constexpr (kChannels == 2)
+      downmixStereo(frames, lease_->in, kBlocksize);
+    else
+      copyMono(frames, lease_->in, kBlocksize);
+  }
+  void windowAndFFT()
+  {
+    if (hop_ < kBlocksize)
+      for (int i = 0; i < kBlocksize; i++)
+        lease_->in[i] *= window_[i];
+    lease_->runFFT(kBlocksize);
+  }
+  BandFeatures const& featuresOfOut(double pitch_hz)
+  {
+    scaledPowerInPlace(lease_->out, kNumBins, scale_);
+    return band_features_.process(lease_->out, pitch_hz);
+  }
+
+  const std::unique_ptr<FourierLease> owned_lease_;
+  FourierLease* const lease_;
+  const int hop_;
+  const double scale_;
+  std::unique_ptr<ZoomPitchTracker> pitch_tracker_;
+  FourierReal window_[kBlocksize]; // Hann; only used if hop_ < kBlocksize
+  BandFeatureStage<kBlocksize> band_features_;
+};
+
+template<int kBlocksize, int kChannels>
+std::unique_ptr<SpectrumPipeline> makeFor(double scale,
+                                          SpectrumPipelineOptions const& options)
+{
+  const int hop = options.hop > 0 ? options.hop : kBlocksize;
+  if (!isSupportedHop(hop, kBlocksize))
+    crash("unsupported hop for this Fourier block size");
+  return std::make_unique<FFTPipeline<kBlocksize, kChannels>>(scale, hop, options);
+}
+
+template<int kBlocksize>
+std::unique_ptr<SpectrumPipeline> makeForBlocksize(
+    int num_channels, double scale, SpectrumPipelineOptions const& options)
+{
+  if (num_channels == 2)
+    return makeFor<kBlocksize, 2>(scale, options);
+  if (num_channels == 1)
+    return makeFor<kBlocksize, 1>(scale, options);
+  crash("the DSP pipeline supports only 1 or 2 channel audio");
+  return nullptr;
+}
+
+} // namespace
+
+std::unique_ptr<SpectrumPipeline> makeSpectrumPipeline(
+    int blocksize, int num_channels, double scale,
+    SpectrumPipelineOptions const& options)
+{
+  static_assert(std::size(kSupportedBlocksizes) == 4,
+                "add any new block size to the switch below");
+  switch (blocksize)
+  {
+  case 128: return makeForBlocksize<128>(num_channels, scale, options);
+  case 256: return makeForBlocksize<256>(num_channels, scale, options);
+  case 512: return makeForBlocksize<512>(num_channels, scale, options);
+  case 1024: return makeForBlocksize<1024>(num_channels, scale, options);
+  }
+  crash("unsupported Fourier block size");
+  return nullptr;
+}
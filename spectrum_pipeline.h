@@ -0,0 +1,62 @@
+#ifndef CLICKITONGUE_SPECTRUM_PIPELINE_H_
+#define CLICKITONGUE_SPECTRUM_PIPELINE_H_
+
+#include <memory>
+
+#include "band_features.h"
+#include "constants.h"
+#include "easy_fourier.h"
+
+// The per-block DSP chain: a block of audio in, BandFeatures out (optionally
+// with the hum's pitch). Blocks start hop() frames apart; if that's less than
+// blocksize(), they overlap, and are Hann windowed. There is an implementation
+// for each (block size, channel count) combination, so the loops inside run
+// over compile-time sizes and octave bin ranges, and never re-check the
+// channel count; makeSpectrumPipeline() picks one at runtime.
+//
+// Powers are scale * |X_k|^2, times (kDefaultFourierBlocksize / blocksize)^2.
+// The latter makes an octave's power (the sum over its bins, which scales
+// with the square of the block size for both tones and noise) come out about
+// the same at any block size, so thresholds keep their meaning. Windowed
+// powers are likewise scaled back up by the window's 8/3 loss of power.
+class SpectrumPipeline
+{
+public:
+  virtual ~SpectrumPipeline() {}
+
+  // frames: blocksize() frames of interleaved audio, of which the last hop()
+  // are new since the previous call. The returned reference is valid until
+  // the next call.
+  virtual BandFeatures const& process(const Sample* frames) = 0;
+
+  // The two halves of process(), for when many blocks' features come from
+  // one block's spectrum (see ComplexSpectrogram). spectrum() writes the
+  // (unscaled, windowed if overlapping) complex spectrum of frames to out,
+  // blocksize()/2 + 1 bins; processSpectrum() goes from such a spectrum the
+  // rest of the way to BandFeatures, without pitch.
+  virtual void spectrum(const Sample* frames, FourierComplex* out) = 0;
+  virtual BandFeatures const& processSpectrum(const FourierComplex* bins) = 0;
+
+  virtual int blocksize() const = 0;
+  virtual int hop() const = 0;
+};
+
+struct SpectrumPipelineOptions
+{
+  // Frames from one block to the next (see isSupportedHop()); 0 means the
+  // block size, i.e. no overlap.
+  int hop = 0;
+  // Fill in BandFeatures::pitch_hz, with a ZoomPitchTracker.
+  bool track_pitch = false;
+  // Run FFTs on this lease's worker, rather than borrowing one for
+  // the pipeline's lifetime. Lets pipelines that are only ever run one at a
+  // time, on one thread, share a worker. Must outlive the pipeline.
+  FourierLease* shared_lease = nullptr;
+};
+
+// blocksize: from kSupportedBlocksizes. num_channels: 1 or 2.
+std::unique_ptr<SpectrumPipeline> makeSpectrumPipeline(
+    int blocksize, int num_channels, double scale,
+    SpectrumPipelineOptions const& options = SpectrumPipelineOptions());
+
+#endif // CLICKITONGUE_SPECTRUM_PIPELINE_H_
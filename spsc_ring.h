@@ -0,0 +1,86 @@
+#ifndef CLICKITONGUE_SPSC_RING_H_
+#define CLICKITONGUE_SPSC_RING_H_
+
+#include <atomic>
+#include <cstdint>
+
+// A fixed-capacity FIFO for exactly one producer thread and one consumer
+// thread. Both tryPush() and tryPop() are wait-free: no locks, no allocation,
+// no syscalls, a bounded number of steps. So, safe to call from a real-time
+// thread (e.g. the PortAudio callback). Waking a sleeping consumer is up to
+// the user, and isn't free: e.g. DspThread::enqueueBlock() follows each push
+// with a Wakeup::wake(), which on Linux is one (non-blocking) write().
+//
+// kCapacity must be a power of two. T should be cheap to copy.
+template<class T, int kCapacity>
+class SpscRing
+{
+  static_assert(kCapacity > 0 && (kCapacity & (kCapacity - 1)) == 0,
+                "SpscRing capacity must be a power of two");
+
+public:
+  // Producer only. Returns false (and drops obj) if the ring is full.
+  bool tryPush(T const& obj)
+  {
+    const uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == kCapacity)
+      return false;
+    slots_[tail & (kCapacity - 1)] = obj;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer only. Returns false if the ring is empty.
+  bool tryPop(T* obj)
+  {
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire))
+      return false;
+    *obj = slots_[head & (kCapacity - 1)];
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // In-place alternatives to tryPush() and tryPop(), for when T is big enough
+  // that copying it around matters. Producer: pushSlot() returns the slot to
+  // fill in (nullptr if full), which then becomes visible on commitPush().
+  // Consumer: frontSlot() returns the oldest item (nullptr if empty), which
+  // stays valid until commitPop().
+  T* pushSlot()
+  {
+    const uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == kCapacity)
+      return nullptr;
+    return &slots_[tail & (kCapacity - 1)];
+  }
+  void commitPush()
+  {
+    tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+  T* frontSlot()
+  {
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire))
+      return nullptr;
+    return &slots_[head & (kCapacity - 1)];
+  }
+  void commitPop()
+  {
+    head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  // Either side; only a snapshot, of course.
+  int size() const
+  {
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    return tail_.load(std::memory_order_acquire) - head;
+  }
+
+private:
+  // (Each index on its own cache line, so the two threads don't contend).
+  alignas(64) std::atomic<uint64_t> head_{0}; // next slot to pop
+  alignas(64) std::atomic<uint64_t> tail_{0}; // next slot to push
+  alignas(64) T slots_[kCapacity];
+};
+
+#endif // CLICKITONGUE_SPSC_RING_H_
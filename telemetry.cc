@@ -0,0 +1,82 @@
+#include "telemetry.h"
+
+#include <chrono>
+#include <thread>
+
+#include "interaction.h"
+#include "latency_tracker.h"
+
+#ifdef CLICKITONGUE_LINUX
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+extern bool g_show_debug_info;
+
+void Telemetry::recordOctaves(BandFeatures const& features)
+{
+  Record record;
+  record.nanos = latencyNowNanos();
+  for (int k = 0; k <= kNumOctaves; k++)
+    record.octave[k] = features.octave[k];
+  if (!ring_.tryPush(record))
+    dropped_records_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Telemetry::drain()
+{
+  Record record;
+  while (ring_.tryPop(&record))
+  {
+    const double* o = record.octave;
+    // (Only the interesting blocks; same as printOctavesAlreadyFreq()).
+    if (o[5] > 1000 || o[6] > 200 || o[7] > 100)
+      PRINTF("%f\t%f\t%f\t%f\t%f\t%f\t%f\n", o[1], o[2], o[3], o[4], o[5], o[6], o[7]);
+  }
+
+  uint64_t overflows = input_overflows_.load(std::memory_order_relaxed);
+  if (overflows > input_overflows_reported_ && g_show_debug_info)
+  {
+    PRINTF("audio input overflowed (xrun): %llu times in %llu callbacks\n",
+           (unsigned long long)overflows,
+           (unsigned long long)callbacks_.load(std::memory_order_relaxed));
+  }
+  input_overflows_reported_ = overflows;
+
+  uint64_t dsp_overflows = dsp_overflows_.load(std::memory_order_relaxed);
+  if (dsp_overflows > dsp_overflows_reported_)
+  {
+    PRINTF("DSP thread fell behind: %llu blocks of audio dropped so far\n",
+           (unsigned long long)dsp_overflows);
+  }
+  dsp_overflows_reported_ = dsp_overflows;
+
+  uint64_t dropped = dropped_records_.load(std::memory_order_relaxed);
+  if (dropped > dropped_records_reported_)
+  {
+    PRINTF("telemetry logger fell behind: %llu records dropped so far\n",
+           (unsigned long long)dropped);
+  }
+  dropped_records_reported_ = dropped;
+}
+
+Telemetry* telemetry()
+{
+  static Telemetry* ret = new Telemetry;
+  return ret;
+}
+
+void telemetryLogger()
+{
+#ifdef CLICKITONGUE_LINUX
+  // Only runs when nothing else wants the CPU - in particular, never
+  // competes with the audio thread.
+  sched_param param{};
+  pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+  while (true)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    telemetry()->drain();
+  }
+}
@@ -0,0 +1,57 @@
+#ifndef CLICKITONGUE_TELEMETRY_H_
+#define CLICKITONGUE_TELEMETRY_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include "band_features.h"
+#include "spsc_ring.h"
+
+// Debug output and counters from the audio callback. The callback must stay
+// real-time safe - no stdio, locks, or allocation - so rather than printing,
+// it drops records into a lock-free ring (or bumps an atomic counter), and
+// telemetryLogger(), in its own low-priority thread, does the printing.
+//
+// recordOctaves() must only be called from one thread (whichever runs the
+// detectors); the count functions are fine from any.
+class Telemetry
+{
+public:
+  struct Record
+  {
+    int64_t nanos; // latencyNowNanos() when recorded
+    double octave[kNumOctaves + 1];
+  };
+
+  // The --debug octave printout.
+  void recordOctaves(BandFeatures const& features);
+  void countCallback() { callbacks_.fetch_add(1, std::memory_order_relaxed); }
+  void countInputOverflow()
+  {
+    input_overflows_.fetch_add(1, std::memory_order_relaxed);
+  }
+  // DspThread's queue was full, so a block of audio went unprocessed.
+  void countDspOverflow() { dsp_overflows_.fetch_add(1, std::memory_order_relaxed); }
+
+  // Logger thread only. Prints everything recorded since the last call.
+  void drain();
+
+private:
+  static constexpr int kRingCapacity = 256;
+  SpscRing<Record, kRingCapacity> ring_;
+  std::atomic<uint64_t> callbacks_{0};
+  std::atomic<uint64_t> input_overflows_{0};
+  std::atomic<uint64_t> dsp_overflows_{0};
+  std::atomic<uint64_t> dropped_records_{0};
+
+  // (Logger thread's side).
+  uint64_t input_overflows_reported_ = 0;
+  uint64_t dsp_overflows_reported_ = 0;
+  uint64_t dropped_records_reported_ = 0;
+};
+Telemetry* telemetry();
+
+// run me in my own thread
+void telemetryLogger();
+
+#endif // CLICKITONGUE_TELEMETRY_H_
@@ -3,14 +3,21 @@
 #include <algorithm>
 #include <array>
 #include <cassert>
+#include <climits>
+#include <cmath>
+#include <map>
+#include <optional>
+#include <queue>
 #include <random>
-#include <thread>
 #include <vector>
 
 #include "audio_recording.h"
-#include "blow_detector.h"
-#include "fft_result_distributor.h"
+#include "detector_bank.h"
 #include "interaction.h"
+#include "score_memo.h"
+#include "training_corpus.h"
+#include "training_seed.h"
+#include "work_stealing_pool.h"
 
 namespace {
 
@@ -60,43 +67,21 @@ public:
     return false;
   }
 
-  int detectEvents(std::vector<Sample> const& samples, FFTResultDistributor& fft)
+  using Bank = BlowDetectorBank;
+  // Adds a lane to bank that behaves like the detector these params describe.
+  void addLaneTo(Bank* bank) const
   {
-    std::vector<int> event_frames;
-    std::vector<std::unique_ptr<Detector>> just_one_detector;
-    just_one_detector.emplace_back(std::make_unique<BlowDetector>(
-        nullptr, o1_on_thresh, o7_on_thresh, o7_off_thresh,
-        lookback_blocks, /*require_delay=*/false, &event_frames));
-    fft.replaceDetectors(std::move(just_one_detector));
-
-    for (int sample_ind = 0;
-         sample_ind + kFourierBlocksize * g_num_channels < samples.size();
-         sample_ind += kFourierBlocksize * g_num_channels)
-    {
-      fft.processAudio(samples.data() + sample_ind, kFourierBlocksize);
-    }
-    return event_frames.size();
+    bank->addLane(o1_on_thresh, o7_on_thresh, o7_off_thresh, lookback_blocks,
+                  /*require_delay=*/false);
   }
 
-  // For each example-set, detectEvents on each example, and sum up that sets'
-  // total violations. The score is a vector of those violations, one count per
-  // example-set.
-  void computeScore(std::vector<std::vector<std::pair<AudioRecording, int>>>
-                    const& example_sets)
+  // Everything addLaneTo() passes on, for ScoreMemo.
+  ScoreMemoKey memoKey() const
   {
-    score.clear();
-    FFTResultDistributor fft({}, scale, /*training=*/true);
-    for (auto const& examples : example_sets)
-    {
-      int violations = 0;
-      for (auto const& example_and_expected : examples)
-      {
-        int events = detectEvents(example_and_expected.first.samples(), fft);
-        violations += abs(events - example_and_expected.second);
-      }
-      score.push_back(violations);
-    }
+    return {quantizeParam(o1_on_thresh), quantizeParam(o7_on_thresh),
+            quantizeParam(o7_off_thresh), lookback_blocks};
   }
+
   std::string scoreToString() const
   {
     std::string ret = "{";
@@ -122,16 +107,11 @@ public:
   std::vector<int> score;
 };
 
-std::random_device* getRandomDev()
-{
-  static std::random_device* dev = new std::random_device;
-  return dev;
-}
 class RandomStuff
 {
 public:
   RandomStuff(double low, double high)
-    : mt_((*getRandomDev())()), dist_(low, high) {}
+    : mt_(nextTrainingSeed()), dist_(low, high) {}
 
   double random() { return dist_(mt_); }
 
@@ -162,36 +142,6 @@ int randomLookbackBlocks()
   return (int)r->random(); // close enough lol
 }
 
-void runComputeScore(
-    TrainParams* me,
-    std::vector<std::vector<std::pair<AudioRecording, int>>> const& example_sets)
-{
-  me->computeScore(example_sets);
-}
-
-class TrainParamsCocoon
-{
-public:
-  TrainParamsCocoon(
-      double o1_on_thresh, double o7_on_thresh, double o7_off_thresh,
-      int lookback_blocks, double scale,
-      std::vector<std::vector<std::pair<AudioRecording, int>>> const& example_sets)
-  : pupa_(std::make_unique<TrainParams>(o1_on_thresh, o7_on_thresh, o7_off_thresh,
-                                        lookback_blocks, scale)),
-    score_computer_(std::make_unique<std::thread>(runComputeScore, pupa_.get(),
-                                                  example_sets)) {}
-  TrainParams awaitHatch()
-  {
-    PRINTF("."); fflush(stdout);
-    score_computer_->join();
-    return *pupa_;
-  }
-
-private:
-  std::unique_ptr<TrainParams> pupa_;
-  std::unique_ptr<std::thread> score_computer_;
-};
-
 class TrainParamsFactory
 {
 public:
@@ -199,19 +149,19 @@ public:
                      double scale, bool mic_near_mouth);
 
   bool emplaceIfValid(
-      std::vector<TrainParamsCocoon>& ret, double o1_on_thresh,
+      std::vector<TrainParams>& ret, double o1_on_thresh,
       double o7_on_thresh, double o7_off_thresh, int lookback_blocks)
   {
     if (o7_off_thresh < o7_on_thresh)
     {
       ret.emplace_back(o1_on_thresh, o7_on_thresh, o7_off_thresh, lookback_blocks,
-                       scale_, examples_sets_);
+                       scale_);
       return true;
     }
     return false;
   }
 
-  void emplaceRandomParams(std::vector<TrainParamsCocoon>& ret)
+  void emplaceRandomParams(std::vector<TrainParams>& ret)
   {
     while (true)
     {
@@ -229,9 +179,9 @@ public:
 
 #define HIDEOUS_FOR(x, mn, mx) for (double x = mn + 0.25*( mx - mn ); x <= mn + 0.75*( mx - mn ); x += 0.5*( mx - mn ))
 
-  std::vector<TrainParamsCocoon> startingSet()
+  std::vector<TrainParams> startingSet()
   {
-    std::vector<TrainParamsCocoon> ret;
+    std::vector<TrainParams> ret;
     HIDEOUS_FOR(o1_on_thresh, kMinO1On, kMaxO1On)
     HIDEOUS_FOR(o7_on_thresh, kMinO7On, kMaxO7On)
     HIDEOUS_FOR(o7_off_thresh, kMinO7Off, kMaxO7Off)
@@ -245,7 +195,7 @@ public:
                      0.5*(kMaxO7On-kMinO7On),
                      0.5*(kMaxO7Off-kMinO7Off),
                      0.5*(kMaxLookbackBlocks-kMinLookbackBlocks),
-                     scale_, examples_sets_);
+                     scale_);
     for (int i = 0; i < 25; i++)
       emplaceRandomParams(ret);
     return ret;
@@ -253,9 +203,9 @@ public:
 
 #define KEEP_IN_BOUNDS(mn,x,mx) do { x = std::min(x, mx); x = std::max(x, mn); } while(false)
 
-  std::vector<TrainParamsCocoon> patternAround(TrainParams x)
+  std::vector<TrainParams> patternAround(TrainParams x)
   {
-    std::vector<TrainParamsCocoon> ret;
+    std::vector<TrainParams> ret;
 
     double left_o1_on_thresh = x.o1_on_thresh - (kMaxO1On-kMinO1On)/pattern_divisor_;
     KEEP_IN_BOUNDS(kMinO1On, left_o1_on_thresh, kMaxO1On);
@@ -304,9 +254,8 @@ public:
 
   void shrinkSteps() { pattern_divisor_ *= 2.0; }
 
-  // A vector of example-sets. Each example-set is a vector of samples of audio,
-  // paired with how many events are expected to be in that audio.
-  std::vector<std::vector<std::pair<AudioRecording, int>>> examples_sets_;
+  std::shared_ptr<const TrainingCorpus> corpus_;
+  ScoreMemo score_memo_;
 private:
   // The factor that all Fourier power outputs will be multiplied by.
   const double scale_;
@@ -320,10 +269,8 @@ private:
 TrainParamsFactory::TrainParamsFactory(
     std::vector<std::pair<AudioRecording, int>> const& raw_examples,
     double scale, bool mic_near_mouth)
-  : scale_(scale)
-{
-  TrainParamsFactoryCtorCommon(&examples_sets_, raw_examples, scale, mic_near_mouth);
-}
+  : corpus_(makeTrainingCorpus(raw_examples, scale, mic_near_mouth)),
+    scale_(scale) {}
 
 } // namespace
 
@@ -343,7 +290,7 @@ BlowConfig trainBlow(std::vector<std::pair<AudioRecording, int>> const& audio_ex
   // and it's not even that long. We could use it if we had more long blowing
   // time to go on.
   //tune(&best, &best.o7_off_thresh, /*tune_up=*/false,
-  //     kMinO7Off, best.o7_off_thresh, 0.5, "o7_off", factory.examples_sets_);
+  //     kMinO7Off, best.o7_off_thresh, 0.5, "o7_off", factory);
 
   BlowConfig ret;
   ret.scale = scale;
@@ -3,14 +3,21 @@
 #include <algorithm>
 #include <array>
 #include <cassert>
+#include <climits>
+#include <cmath>
+#include <map>
+#include <optional>
+#include <queue>
 #include <random>
-#include <thread>
 #include <vector>
 
 #include "audio_recording.h"
-#include "cat_detector.h"
-#include "fft_result_distributor.h"
+#include "detector_bank.h"
 #include "interaction.h"
+#include "score_memo.h"
+#include "training_corpus.h"
+#include "training_seed.h"
+#include "work_stealing_pool.h"
 
 namespace {
 
@@ -54,42 +61,19 @@ public:
     return false;
   }
 
-  int detectEvents(std::vector<Sample> const& samples, FFTResultDistributor& fft)
+  using Bank = CatDetectorBank;
+  // Adds a lane to bank that behaves like the detector these params describe.
+  void addLaneTo(Bank* bank) const
   {
-    std::vector<int> event_frames;
-    std::vector<std::unique_ptr<Detector>> just_one_detector;
-    just_one_detector.emplace_back(std::make_unique<CatDetector>(nullptr,
-        o7_on_thresh, o1_limit, use_limit, &event_frames));
-    fft.replaceDetectors(std::move(just_one_detector));
-
-    for (int sample_ind = 0;
-         sample_ind + kFourierBlocksize * g_num_channels < samples.size();
-         sample_ind += kFourierBlocksize * g_num_channels)
-    {
-      fft.processAudio(samples.data() + sample_ind, kFourierBlocksize);
-    }
-    return event_frames.size();
+    bank->addLane(o7_on_thresh, o1_limit, use_limit);
   }
 
-  // For each example-set, detectEvents on each example, and sum up that sets'
-  // total violations. The score is a vector of those violations, one count per
-  // example-set.
-  void computeScore(std::vector<std::vector<std::pair<AudioRecording, int>>>
-                    const& example_sets)
+  // Everything addLaneTo() passes on, for ScoreMemo.
+  ScoreMemoKey memoKey() const
   {
-    score.clear();
-    FFTResultDistributor fft({}, scale, /*training=*/true);
-    for (auto const& examples : example_sets)
-    {
-      int violations = 0;
-      for (auto const& example_and_expected : examples)
-      {
-        int events = detectEvents(example_and_expected.first.samples(), fft);
-        violations += abs(events - example_and_expected.second);
-      }
-      score.push_back(violations);
-    }
+    return {quantizeParam(o7_on_thresh), quantizeParam(o1_limit), use_limit, 0};
   }
+
   std::string scoreToString() const
   {
     std::string ret = "{";
@@ -113,16 +97,11 @@ public:
   std::vector<int> score;
 };
 
-std::random_device* getRandomDev()
-{
-  static std::random_device* dev = new std::random_device;
-  return dev;
-}
 class RandomStuff
 {
 public:
   RandomStuff(double low, double high)
-    : mt_((*getRandomDev())()), dist_(low, high) {}
+    : mt_(nextTrainingSeed()), dist_(low, high) {}
 
   double random() { return dist_(mt_); }
 
@@ -143,52 +122,24 @@ double randomO1Limit()
   return r->random();
 }
 
-void runComputeScore(
-    TrainParams* me,
-    std::vector<std::vector<std::pair<AudioRecording, int>>> const& example_sets)
-{
-  me->computeScore(example_sets);
-}
-
-class TrainParamsCocoon
-{
-public:
-  TrainParamsCocoon(
-      double o7_on_thresh, double o1_limit, bool use_limit, double scale,
-      std::vector<std::vector<std::pair<AudioRecording, int>>> const& example_sets)
-  : pupa_(std::make_unique<TrainParams>(o7_on_thresh, o1_limit, use_limit, scale)),
-    score_computer_(std::make_unique<std::thread>(runComputeScore, pupa_.get(),
-                                                  example_sets)) {}
-  TrainParams awaitHatch()
-  {
-    PRINTF("."); fflush(stdout);
-    score_computer_->join();
-    return *pupa_;
-  }
-
-private:
-  std::unique_ptr<TrainParams> pupa_;
-  std::unique_ptr<std::thread> score_computer_;
-};
-
 class TrainParamsFactory
 {
 public:
   TrainParamsFactory(std::vector<std::pair<AudioRecording, int>> const& raw_examples,
                      double scale, bool mic_near_mouth);
 
-  bool emplaceIfValid(std::vector<TrainParamsCocoon>& ret,
+  bool emplaceIfValid(std::vector<TrainParams>& ret,
                       double o7_on_thresh, double o1_limit)
   {
     if (true)
     {
-      ret.emplace_back(o7_on_thresh, o1_limit, true, scale_, examples_sets_);
-      ret.emplace_back(o7_on_thresh, o1_limit, false, scale_, examples_sets_);
+      ret.emplace_back(o7_on_thresh, o1_limit, true, scale_);
+      ret.emplace_back(o7_on_thresh, o1_limit, false, scale_);
       return true;
     }
   }
 
-  void emplaceRandomParams(std::vector<TrainParamsCocoon>& ret)
+  void emplaceRandomParams(std::vector<TrainParams>& ret)
   {
     while (true)
     {
@@ -201,9 +152,9 @@ public:
 
 #define HIDEOUS_FOR(x, mn, mx) for (double x = mn + 0.25*( mx - mn ); x <= mn + 0.75*( mx - mn ); x += 0.5*( mx - mn ))
 
-  std::vector<TrainParamsCocoon> startingSet()
+  std::vector<TrainParams> startingSet()
   {
-    std::vector<TrainParamsCocoon> ret;
+    std::vector<TrainParams> ret;
     HIDEOUS_FOR(o7_on_thresh, kMinO7On, kMaxO7On)
     HIDEOUS_FOR(o1_limit, kMinO1Limit, kMaxO1Limit)
     {
@@ -219,9 +170,9 @@ public:
 
 #define KEEP_IN_BOUNDS(mn,x,mx) do { x = std::min(x, mx); x = std::max(x, mn); } while(false)
 
-  std::vector<TrainParamsCocoon> patternAround(TrainParams x)
+  std::vector<TrainParams> patternAround(TrainParams x)
   {
-    std::vector<TrainParamsCocoon> ret;
+    std::vector<TrainParams> ret;
 
     double left_o7_on_thresh = x.o7_on_thresh - (kMaxO7On-kMinO7On)/pattern_divisor_;
     KEEP_IN_BOUNDS(kMinO7On, left_o7_on_thresh, kMaxO7On);
@@ -255,9 +206,8 @@ public:
 
   void shrinkSteps() { pattern_divisor_ *= 2.0; }
 
-  // A vector of example-sets. Each example-set is a vector of samples of audio,
-  // paired with how many events are expected to be in that audio.
-  std::vector<std::vector<std::pair<AudioRecording, int>>> examples_sets_;
+  std::shared_ptr<const TrainingCorpus> corpus_;
+  ScoreMemo score_memo_;
 private:
   // The factor that all Fourier power outputs will be multiplied by.
   const double scale_;
@@ -271,10 +221,8 @@ private:
 TrainParamsFactory::TrainParamsFactory(
     std::vector<std::pair<AudioRecording, int>> const& raw_examples,
     double scale, bool mic_near_mouth)
-  : scale_(scale)
-{
-  TrainParamsFactoryCtorCommon(&examples_sets_, raw_examples, scale, mic_near_mouth);
-}
+  : corpus_(makeTrainingCorpus(raw_examples, scale, mic_near_mouth)),
+    scale_(scale) {}
 
 } // namespace
 
@@ -297,7 +245,7 @@ CatConfig trainCat(std::vector<std::pair<AudioRecording, int>> const& audio_exam
   {
     TrainParams no_limit = best;
     no_limit.use_limit = false;
-    no_limit.computeScore(factory.examples_sets_);
+    computeScore(&no_limit, factory);
     if (!(best < no_limit))
       best = no_limit;
   }
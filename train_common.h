@@ -6,56 +6,6 @@
 // Hacky, but does clean things up a bit, and I'm not sure there's a clean way
 // to do it the "right" way with an interface base class.
 
-void TrainParamsFactoryCtorCommon(
-    std::vector<std::vector<std::pair<AudioRecording, int>>>* examples_sets,
-    std::vector<std::pair<AudioRecording, int>> const& raw_examples,
-    double scale, bool mic_near_mouth)
-{
-  std::vector<AudioRecording> noises;
-  noises.emplace_back("data/noise1.pcm");
-  noises.back().scale(1.0 / scale);
-  noises.emplace_back("data/noise2.pcm");
-  noises.back().scale(1.0 / scale);
-  noises.emplace_back("data/noise3.pcm");
-  noises.back().scale(1.0 / scale);
-
-  // If we're training for mic-near-mouth, the base examples should include a
-  // recording of light (but near the mic) mouth breathing.
-  std::vector<std::pair<AudioRecording, int>> base_examples = raw_examples;
-  if (mic_near_mouth)
-  {
-    base_examples.emplace_back(AudioRecording("data/breath.pcm"), 0);
-    base_examples.back().first.scale(1.0 / scale);
-  }
-
-  // First, add the base examples, without any noise.
-  examples_sets->push_back(base_examples);
-
-  // A loud version of the base examples, to make one type less likely to cause
-  // false positives for another.
-  {
-    std::vector<std::pair<AudioRecording, int>> examples = base_examples;
-    for (auto& x : examples)
-      x.first.scale(1.25);
-    examples_sets->push_back(examples);
-  }
-  // For each noise sample, our raw examples plus that noise.
-  for (auto const& noise : noises)
-  {
-    std::vector<std::pair<AudioRecording, int>> examples = base_examples;
-    for (auto& x : examples)
-      x.first += noise;
-    examples_sets->push_back(examples);
-  }
-  // Finally, a quiet version, for a challenge/tie breaker.
-  {
-    std::vector<std::pair<AudioRecording, int>> examples = base_examples;
-    for (auto& x : examples)
-      x.first.scale(0.75);
-    examples_sets->push_back(examples);
-  }
-}
-
 void addEqualReplaceBetter(std::vector<TrainParams>* best, TrainParams cur,
                            int max_length)
 {
@@ -83,14 +33,422 @@ void addEqualReplaceBetter(std::vector<TrainParams>* best, TrainParams cur,
 
 FILE* g_training_log;
 
-std::vector<TrainParams> getInitialBest(TrainParamsFactory& factory)
+// How many candidates share one TrainParams::Bank.
+constexpr int kCandidatesPerBank = 16;
+
+// How often each example of the base (noiseless) set has cost a candidate a
+// violation, per candidate replayed over it. Scoring replays the base set's
+// examples most-violating first, so that hopeless candidates pile up enough
+// violations to be cut off (see ScoreCutoff) as early as possible. Kept for
+// a whole training run, so later candidates benefit from what earlier ones
+// showed.
+class ExampleOrder
+{
+public:
+  explicit ExampleOrder(int num_examples)
+    : violations_(num_examples), replays_(num_examples) {}
+
+  // Example indices, highest violation rate first (ties in corpus order).
+  std::vector<int> order() const
+  {
+    std::vector<double> rate(violations_.size());
+    for (int i = 0; i < rate.size(); i++)
+    {
+      const long long replays = replays_[i].load(std::memory_order_relaxed);
+      rate[i] = replays == 0 ? 0 : violations_[i].load(std::memory_order_relaxed) /
+                                   (double)replays;
+    }
+    std::vector<int> ret(rate.size());
+    for (int i = 0; i < ret.size(); i++)
+      ret[i] = i;
+    std::stable_sort(ret.begin(), ret.end(),
+                     [&rate](int a, int b) { return rate[a] > rate[b]; });
+    return ret;
+  }
+
+  void record(int example_ind, int violations, int candidates)
+  {
+    violations_[example_ind].fetch_add(violations, std::memory_order_relaxed);
+    replays_[example_ind].fetch_add(candidates, std::memory_order_relaxed);
+  }
+
+private:
+  std::vector<std::atomic<long long>> violations_;
+  std::vector<std::atomic<long long>> replays_;
+};
+
+// Where a scoreCandidates() call's candidates are headed once scored: each in
+// turn, in order, through addEqualReplaceBetter(kept, candidate, max_length).
+// Knowing that lets scoring give up on candidates that can't get in.
+struct KeptSet
+{
+  std::vector<TrainParams> const* kept;
+  int max_length;
+  ExampleOrder* example_order;
+};
+
+// The score[0] beyond which a scoreCandidates() call's candidates can no
+// longer make it into their KeptSet, shared by all of the call's tasks.
+//
+// addEqualReplaceBetter() only takes a candidate if the list has room, or if
+// it beats the entry at max_length-1; and that entry never gets worse. It's
+// also never worse than the max_length'th best distinct candidate the list
+// has seen. So, a candidate whose score[0] exceeds that of the max_length'th
+// best of (the kept list, plus every candidate before it) can't get in -
+// and then nothing about its score matters. (The list depends on the order
+// candidates arrive in, so only earlier candidates can tighten the bound on
+// later ones: the bound here comes from the longest run of banks, from the
+// first, whose base set scores are all in).
+class ScoreCutoff
+{
+public:
+  ScoreCutoff(std::vector<TrainParams> const& candidates, KeptSet const& kept_set,
+              int num_banks)
+    : max_length_(kept_set.max_length), counts_toward_bound_(candidates.size()),
+      bank_score0s_(num_banks)
+  {
+    std::vector<TrainParams> const& kept = *kept_set.kept;
+    if (kept.size() >= max_length_)
+      kept_bound_ = kept[max_length_ - 1].score[0];
+    // (Candidates equal to one seen before can't take a new place on the list).
+    for (int i = 0; i < kept.size(); i++)
+      if (std::find(kept.begin(), kept.begin() + i, kept[i]) == kept.begin() + i)
+        addScore0(&kept_smallest_, kept[i].score[0]);
+    for (int i = 0; i < candidates.size(); i++)
+    {
+      counts_toward_bound_[i] =
+          std::find(kept.begin(), kept.end(), candidates[i]) == kept.end() &&
+          std::find(candidates.begin(), candidates.begin() + i, candidates[i]) ==
+              candidates.begin() + i;
+    }
+    smallest_ = kept_smallest_;
+    bound_ = std::min(kept_bound_, smallestBound(smallest_));
+  }
+
+  // A still-unscored candidate whose base set violations exceed this is
+  // hopeless.
+  int bound() const { return bound_.load(std::memory_order_relaxed); }
+
+  // score0s: the final base set violations of the lanes of bank_ind.
+  void finishBank(int bank_ind, std::vector<int> const& score0s)
+  {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    bank_score0s_[bank_ind] = score0s;
+    for (; frontier_ < bank_score0s_.size() && !bank_score0s_[frontier_].empty();
+         frontier_++)
+    {
+      addBank(&smallest_, frontier_);
+    }
+    bound_ = std::min(bound_.load(std::memory_order_relaxed),
+                      smallestBound(smallest_));
+  }
+
+  // Whether candidate i could take a new place on the kept list: it's equal
+  // to neither a kept candidate nor an earlier one.
+  bool countsTowardBound(int i) const { return counts_toward_bound_[i]; }
+
+  // Once every bank has finished: the tightest bound on each bank's
+  // candidates, i.e. from the kept list and every bank before it.
+  std::vector<int> boundPerBank() const
+  {
+    std::vector<int> ret;
+    std::priority_queue<int> smallest = kept_smallest_;
+    for (int bank_ind = 0; bank_ind < bank_score0s_.size(); bank_ind++)
+    {
+      ret.push_back(std::min(kept_bound_, smallestBound(smallest)));
+      addBank(&smallest, bank_ind);
+    }
+    return ret;
+  }
+
+private:
+  void addScore0(std::priority_queue<int>* smallest, int score0) const
+  {
+    smallest->push(score0);
+    if (smallest->size() > max_length_)
+      smallest->pop();
+  }
+  void addBank(std::priority_queue<int>* smallest, int bank_ind) const
+  {
+    const int first = bank_ind * kCandidatesPerBank;
+    for (int lane = 0; lane < bank_score0s_[bank_ind].size(); lane++)
+      if (counts_toward_bound_[first + lane])
+        addScore0(smallest, bank_score0s_[bank_ind][lane]);
+  }
+  int smallestBound(std::priority_queue<int> const& smallest) const
+  {
+    return smallest.size() < max_length_ ? INT_MAX : smallest.top();
+  }
+
+  const int max_length_;
+  std::vector<char> counts_toward_bound_; // per candidate
+  int kept_bound_ = INT_MAX;
+  // The max_length_ smallest score[0]s of the distinct kept candidates.
+  std::priority_queue<int> kept_smallest_;
+  std::mutex mutex_;
+  std::vector<std::vector<int>> bank_score0s_; // empty until the bank finishes
+  int frontier_ = 0; // every bank before this has finished its base set
+  // The max_length_ smallest score[0]s of the distinct candidates seen.
+  std::priority_queue<int> smallest_;
+  std::atomic<int> bound_;
+};
+
+// Replays the lanes of one bank over one example-set, returning each lane's
+// violations. With a cutoff, the base set stops once every lane is past it
+// (so its violations are then only a lower bound, though still past it).
+std::vector<int> replayBank(std::vector<TrainParams> const& candidates, int first,
+                            int count, TrainingCorpus const& corpus, int set_ind,
+                            int bank_ind, ScoreCutoff* cutoff,
+                            ExampleOrder* example_order)
+{
+  TrainParams::Bank bank;
+  for (int i = first; i < first + count; i++)
+    candidates[i].addLaneTo(&bank);
+
+  TrainingCorpus::ExampleSet const& examples = corpus.set(set_ind);
+  std::vector<int> order;
+  if (set_ind == 0 && example_order)
+    order = example_order->order();
+  else
+    for (int i = 0; i < examples.size(); i++)
+      order.push_back(i);
+
+  std::vector<int> violations(count, 0);
+  for (int example_ind : order)
+  {
+    if (cutoff &&
+        *std::min_element(violations.begin(), violations.end()) > cutoff->bound())
+    {
+      break;
+    }
+    Spectrogram const& spectra = examples[example_ind].first;
+    bank.reset();
+    for (int block_ind = 0; block_ind < spectra.numBlocks(); block_ind++)
+      bank.processBlock(spectra.block(block_ind));
+    int example_violations = 0;
+    for (int lane = 0; lane < count; lane++)
+    {
+      const int v = abs(bank.events(lane) - examples[example_ind].second);
+      violations[lane] += v;
+      example_violations += v;
+    }
+    if (set_ind == 0 && example_order)
+      example_order->record(example_ind, example_violations, count);
+  }
+  if (cutoff)
+    cutoff->finishBank(bank_ind, violations);
+  return violations;
+}
+
+// Runs job(i) for every i in [0, num_jobs) as training pool tasks, and waits
+// for them all. Tasks claim the i's in order, whatever order the pool runs
+// them in.
+template<class Job>
+void runJobsInOrder(int num_jobs, Job job)
+{
+  std::atomic<int> next_job{0};
+  std::vector<std::future<void>> jobs_done;
+  for (int i = 0; i < num_jobs; i++)
+  {
+    // (Capturing by reference is ok; we don't return until these finish.)
+    jobs_done.push_back(trainingPool()->submit([&]()
+    {
+      job(next_job.fetch_add(1));
+    }));
+  }
+  for (auto& job_done : jobs_done)
+    job_done.get();
+}
+
+// With a KeptSet, the share of candidates (the best by base set score, ties
+// included) that go on to be scored on every set; see replayCandidates().
+constexpr double kSurvivingFraction = 0.5;
+// What a candidate that didn't survive gets for each set besides the base:
+// enough to lose any tie-break on them to one that did.
+constexpr int kUnscoredSetViolations = 1 << 20;
+
+// Fills in the score of each of candidates. Candidates are replayed
+// kCandidatesPerBank at a time through a TrainParams::Bank, so each block of
+// each example is read once per bank rather than once per candidate. Each
+// (bank, example-set) pair is its own training pool task.
+//
+// If kept_set is given, scoring is done by successive halving. First, every
+// candidate is scored on just the base (noiseless) set, which decides most
+// comparisons on its own; with a ScoreCutoff, so a candidate that provably
+// can't make the kept list may stop early, with a partial score[0] that's
+// still past every kept candidate's. Then only the survivors are (re-banked
+// and) scored on the other sets: those within the cutoff, and among the
+// best kSurvivingFraction of the distinct new candidates (but at least
+// max_length of them). The rest get kUnscoredSetViolations for the other
+// sets. Returns, for each candidate, whether its score is complete.
+std::vector<char> replayCandidates(std::vector<TrainParams>* candidates,
+                                   TrainingCorpus const& corpus,
+                                   KeptSet const* kept_set)
+{
+  const int num_candidates = candidates->size();
+  const int num_banks = (num_candidates + kCandidatesPerBank - 1) / kCandidatesPerBank;
+  std::unique_ptr<ScoreCutoff> cutoff;
+  if (kept_set)
+    cutoff = std::make_unique<ScoreCutoff>(*candidates, *kept_set, num_banks);
+  ExampleOrder* example_order = kept_set ? kept_set->example_order : nullptr;
+
+  // The base set, for every candidate. (In bank order, so the cutoff
+  // tightens as early as it can).
+  std::vector<std::vector<int>> base_scores(num_banks);
+  runJobsInOrder(num_banks, [&](int bank_ind)
+  {
+    const int first = bank_ind * kCandidatesPerBank;
+    const int count = std::min(kCandidatesPerBank, num_candidates - first);
+    base_scores[bank_ind] = replayBank(*candidates, first, count, corpus,
+                                       /*set_ind=*/0, bank_ind, cutoff.get(),
+                                       example_order);
+  });
+  std::vector<int> score0s;
+  for (int bank_ind = 0; bank_ind < num_banks; bank_ind++)
+  {
+    PRINTF("."); fflush(stdout);
+    score0s.insert(score0s.end(), base_scores[bank_ind].begin(),
+                   base_scores[bank_ind].end());
+  }
+
+  std::vector<int> survivors; // indices into candidates
+  if (!kept_set)
+  {
+    for (int i = 0; i < num_candidates; i++)
+      survivors.push_back(i);
+  }
+  else
+  {
+    const std::vector<int> bounds = cutoff->boundPerBank();
+    // (Of the distinct new candidates only; a repeat can't displace anything).
+    int num_distinct = 0;
+    std::vector<int> complete_score0s;
+    for (int i = 0; i < num_candidates; i++)
+    {
+      if (!cutoff->countsTowardBound(i))
+        continue;
+      num_distinct++;
+      if (score0s[i] <= bounds[i / kCandidatesPerBank])
+        complete_score0s.push_back(score0s[i]);
+    }
+    const int keep = std::max((int)std::ceil(kSurvivingFraction * num_distinct),
+                              kept_set->max_length);
+    int halving_bound = INT_MAX;
+    if (complete_score0s.size() > keep)
+    {
+      std::nth_element(complete_score0s.begin(), complete_score0s.begin() + keep - 1,
+                       complete_score0s.end());
+      halving_bound = complete_score0s[keep - 1];
+    }
+    for (int i = 0; i < num_candidates; i++)
+      if (score0s[i] <= std::min(bounds[i / kCandidatesPerBank], halving_bound))
+        survivors.push_back(i);
+  }
+
+  // The other sets, for just the survivors.
+  std::vector<TrainParams> surviving;
+  for (int i : survivors)
+    surviving.push_back((*candidates)[i]);
+  const int num_other_sets = corpus.numSets() - 1;
+  const int num_surviving_banks =
+      (surviving.size() + kCandidatesPerBank - 1) / kCandidatesPerBank;
+  // [bank index][example-set index - 1] -> violations of each of its lanes.
+  std::vector<std::vector<std::vector<int>>> other_scores(
+      num_surviving_banks, std::vector<std::vector<int>>(num_other_sets));
+  runJobsInOrder(num_surviving_banks * num_other_sets, [&](int job)
+  {
+    const int bank_ind = job % num_surviving_banks;
+    const int set_ind = 1 + job / num_surviving_banks;
+    const int first = bank_ind * kCandidatesPerBank;
+    const int count = std::min(kCandidatesPerBank, (int)surviving.size() - first);
+    other_scores[bank_ind][set_ind - 1] =
+        replayBank(surviving, first, count, corpus, set_ind, bank_ind,
+                   /*cutoff=*/nullptr, /*example_order=*/nullptr);
+  });
+
+  std::vector<char> complete(num_candidates, false);
+  for (int i = 0; i < num_candidates; i++)
+  {
+    (*candidates)[i].score.assign(1 + num_other_sets, kUnscoredSetViolations);
+    (*candidates)[i].score[0] = score0s[i];
+  }
+  for (int j = 0; j < survivors.size(); j++)
+  {
+    TrainParams& candidate = (*candidates)[survivors[j]];
+    for (int set = 0; set < num_other_sets; set++)
+    {
+      candidate.score[set + 1] =
+          other_scores[j / kCandidatesPerBank][set][j % kCandidatesPerBank];
+    }
+    complete[survivors[j]] = true;
+  }
+  return complete;
+}
+
+// replayCandidates(), but answering whatever it can from factory's
+// ScoreMemo, and replaying each distinct candidate only once.
+void scoreCandidates(std::vector<TrainParams>* candidates,
+                     TrainParamsFactory& factory,
+                     KeptSet const* kept_set = nullptr)
+{
+  ScoreMemo& memo = factory.score_memo_;
+  std::vector<TrainParams> unscored;
+  // Index into unscored of each candidate the memo couldn't answer (else -1).
+  std::vector<int> unscored_ind(candidates->size(), -1);
+  std::map<ScoreMemoKey, int> unscored_by_key;
+  for (int i = 0; i < candidates->size(); i++)
+  {
+    TrainParams& candidate = (*candidates)[i];
+    const ScoreMemoKey key = candidate.memoKey();
+    if (std::optional<std::vector<int>> score = memo.find(key))
+    {
+      candidate.score = std::move(*score);
+      continue;
+    }
+    auto [it, is_new] = unscored_by_key.emplace(key, (int)unscored.size());
+    if (is_new)
+      unscored.push_back(candidate);
+    unscored_ind[i] = it->second;
+  }
+  if (unscored.empty())
+    return;
+
+  std::vector<char> complete = replayCandidates(&unscored, *factory.corpus_, kept_set);
+  for (int i = 0; i < unscored.size(); i++)
+    if (complete[i])
+      memo.insert(unscored[i].memoKey(), unscored[i].score);
+  for (int i = 0; i < candidates->size(); i++)
+    if (unscored_ind[i] >= 0)
+      (*candidates)[i].score = unscored[unscored_ind[i]].score;
+}
+
+void logScoreMemo(TrainParamsFactory const& factory)
+{
+  ScoreMemo const& memo = factory.score_memo_;
+  fprintf(g_training_log, "so far, the score memo answered %llu of %llu lookups (%.0f%%)\n",
+          (unsigned long long)memo.hits(), (unsigned long long)memo.lookups(),
+          memo.lookups() == 0 ? 0.0 : 100.0 * memo.hits() / memo.lookups());
+}
+
+// The score is a vector of violation counts, one per example-set.
+void computeScore(TrainParams* params, TrainParamsFactory& factory)
+{
+  std::vector<TrainParams> just_one = {*params};
+  scoreCandidates(&just_one, factory);
+  params->score = just_one.front().score;
+}
+
+std::vector<TrainParams> getInitialBest(TrainParamsFactory& factory,
+                                       ExampleOrder* example_order)
 {
   std::vector<TrainParams> candidates;
-  std::vector<TrainParamsCocoon> cocoons = factory.startingSet();
-  for (auto& cocoon : cocoons)
-    addEqualReplaceBetter(&candidates, cocoon.awaitHatch(), 8);
+  std::vector<TrainParams> starting_set = factory.startingSet();
+  KeptSet kept_set{&candidates, 8, example_order};
+  scoreCandidates(&starting_set, factory, &kept_set);
+  for (auto const& x : starting_set)
+    addEqualReplaceBetter(&candidates, x, 8);
   fprintf(g_training_log, "starting set: kept %d out of %d\n",
-          (int)candidates.size(), (int)cocoons.size());
+          (int)candidates.size(), (int)starting_set.size());
   return candidates;
 }
 
@@ -100,7 +458,8 @@ TrainParams patternSearch(TrainParamsFactory& factory, const char* soundtype)
   fprintf(g_training_log, "beginning %s optimization computations...\n", soundtype);
   PRINTF("beginning %s optimization computations...", soundtype); fflush(stdout);
 
-  std::vector<TrainParams> candidates = getInitialBest(factory);
+  ExampleOrder example_order(factory.corpus_->set(0).size());
+  std::vector<TrainParams> candidates = getInitialBest(factory, &example_order);
 
   int shrinks = 0;
   std::vector<TrainParams> old_candidates;
@@ -109,17 +468,17 @@ TrainParams patternSearch(TrainParamsFactory& factory, const char* soundtype)
   {
     old_candidates = candidates;
 
-    // patternAround() kicks off a bunch of parallel computation, and the
-    // awaitHatch() calls gather it all up.
     for (auto const& candidate : old_candidates)
     {
-      std::vector<TrainParamsCocoon> cocoons = factory.patternAround(candidate);
+      std::vector<TrainParams> points = factory.patternAround(candidate);
       fprintf(g_training_log, "considering %d points around candidate %s %s\n",
-              (int)cocoons.size(),
+              (int)points.size(),
               candidate.scoreToString().c_str(),
               candidate.paramsToString().c_str());
-      for (auto& cocoon : cocoons)
-        addEqualReplaceBetter(&candidates, cocoon.awaitHatch(), 3);
+      KeptSet kept_set{&candidates, 3, &example_order};
+      scoreCandidates(&points, factory, &kept_set);
+      for (auto const& point : points)
+        addEqualReplaceBetter(&candidates, point, 3);
     }
 
     for (auto const& old_best : historical_bests)
@@ -145,6 +504,9 @@ TrainParams patternSearch(TrainParamsFactory& factory, const char* soundtype)
     historical_bests.push_back(candidates.front());
   }
   fprintf(g_training_log, "converged; %s optimization done.\n", soundtype);
+  fprintf(g_training_log, "so far, %llu FourierLease borrows had to wait for a worker\n",
+          (unsigned long long)g_fourier->borrowWaits());
+  logScoreMemo(factory);
   PRINTF("converged; %s optimization done.\n", soundtype);
   return candidates.front();
 }
@@ -182,7 +544,7 @@ AudioRecording recordExampleCommon(int desired_events,
   }
 
   showRecordingBanner();
-  AudioRecording recorder(5/*seconds*/);
+  AudioRecording recorder(5/*seconds*/, /*store_mono=*/true);
   hideRecordingBanner();
 
   return recorder;
@@ -195,7 +557,7 @@ AudioRecording recordExampleCommon(int desired_events,
 void tune(
     TrainParams* obj, double* member_of_obj, bool tune_up,
     double min_val, double max_val, double pullback_fraction, std::string var_name,
-    std::vector<std::vector<std::pair<AudioRecording, int>>> const& examples_sets)
+    TrainParamsFactory& factory)
 {
   double lo_val = min_val;
   double hi_val = max_val;
@@ -209,7 +571,7 @@ void tune(
       break;
     double cur_val = (lo_val + hi_val) / 2.0;
     *member_of_obj = cur_val;
-    obj->computeScore(examples_sets);
+    computeScore(obj, factory);
     if (tune_up)
     {
       if (start < *obj)
@@ -251,7 +613,7 @@ void tune(
   else
     *member_of_obj = hi_val + (start_val - hi_val) * pullback_fraction;
 
-  obj->computeScore(examples_sets);
+  computeScore(obj, factory);
   if (start < *obj)
   {
     if (!var_name.empty())
@@ -276,12 +638,13 @@ void tune(
   TrainParams lower = obj;                                     \
   TrainParams upper = obj;                                     \
   tune(&lower, &lower.VARNAME, false,                          \
-       min_val, lower.VARNAME, 0, "", factory.examples_sets_); \
+       min_val, lower.VARNAME, 0, "", factory);                \
   tune(&upper, &upper.VARNAME, true,                           \
-       upper.VARNAME, max_val, 0, "", factory.examples_sets_); \
+       upper.VARNAME, max_val, 0, "", factory);                \
   obj.VARNAME = (lower.VARNAME + upper.VARNAME) / 2.0;         \
-  obj.computeScore(factory.examples_sets_);                    \
+  computeScore(&obj, factory);                                 \
                                                                \
   fprintf(g_training_log, "tuned %s from %g to %g\n",          \
           var_string_name, start_val, obj.VARNAME);            \
+  logScoreMemo(factory);                                       \
 } while(false);
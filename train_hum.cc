@@ -3,14 +3,22 @@
 #include <algorithm>
 #include <array>
 #include <cassert>
+#include <climits>
+#include <cmath>
+#include <map>
+#include <optional>
+#include <queue>
 #include <random>
-#include <thread>
 #include <vector>
 
 #include "audio_recording.h"
-#include "hum_detector.h"
-#include "fft_result_distributor.h"
+#include "detector_bank.h"
 #include "interaction.h"
+#include "score_memo.h"
+#include "spectrogram.h"
+#include "training_corpus.h"
+#include "training_seed.h"
+#include "work_stealing_pool.h"
 
 namespace {
 
@@ -58,43 +66,22 @@ public:
     return false;
   }
 
-  int detectEvents(std::vector<Sample> const& samples, FFTResultDistributor& fft)
+  using Bank = HumDetectorBank;
+  // Adds a lane to bank that behaves like the detector these params describe.
+  void addLaneTo(Bank* bank) const
   {
-    std::vector<int> event_frames;
-    std::vector<std::unique_ptr<Detector>> just_one_detector;
-    just_one_detector.emplace_back(std::make_unique<HumDetector>(
-        nullptr, o1_on_thresh, o1_off_thresh, o6_limit, kEwmaAlpha,
-        /*require_delay=*/true, &event_frames));
-    fft.replaceDetectors(std::move(just_one_detector));
-
-    for (int sample_ind = 0;
-         sample_ind + kFourierBlocksize * g_num_channels < samples.size();
-         sample_ind += kFourierBlocksize * g_num_channels)
-    {
-      fft.processAudio(samples.data() + sample_ind, kFourierBlocksize);
-    }
-    return event_frames.size();
+    bank->addLane(o1_on_thresh, o1_off_thresh, o6_limit, kEwmaAlpha,
+                 /*require_delay=*/true);
   }
 
-  // for each example-set, detectEvents on each example, and sum up that sets'
-  // total violations. the score is a vector of those violations, one count per
-  // example-set.
-  void computeScore(std::vector<std::vector<std::pair<AudioRecording, int>>>
-                    const& example_sets)
+  // Everything addLaneTo() passes on (but the constant kEwmaAlpha), for
+  // ScoreMemo.
+  ScoreMemoKey memoKey() const
   {
-    score.clear();
-    FFTResultDistributor fft({}, scale, /*training=*/true);
-    for (auto const& examples : example_sets)
-    {
-      int violations = 0;
-      for (auto const& example_and_expected : examples)
-      {
-        int events = detectEvents(example_and_expected.first.samples(), fft);
-        violations += abs(events - example_and_expected.second);
-      }
-      score.push_back(violations);
-    }
+    return {quantizeParam(o1_on_thresh), quantizeParam(o1_off_thresh),
+            quantizeParam(o6_limit), 0};
   }
+
   std::string scoreToString() const
   {
     std::string ret = "{";
@@ -118,16 +105,11 @@ public:
   std::vector<int> score;
 };
 
-std::random_device* getRandomDev()
-{
-  static std::random_device* dev = new std::random_device;
-  return dev;
-}
 class RandomStuff
 {
 public:
   RandomStuff(double low, double high)
-    : mt_((*getRandomDev())()), dist_(low, high) {}
+    : mt_(nextTrainingSeed()), dist_(low, high) {}
 
   double random() { return dist_(mt_); }
 
@@ -153,53 +135,24 @@ double randomO6Limit()
   return r->random();
 }
 
-void runComputeScore(
-    TrainParams* me,
-    std::vector<std::vector<std::pair<AudioRecording, int>>> const& example_sets)
-{
-  me->computeScore(example_sets);
-}
-
-class TrainParamsCocoon
-{
-public:
-  TrainParamsCocoon(
-      double o1_on_thresh, double o1_off_thresh, double o6_limit, double scale,
-      std::vector<std::vector<std::pair<AudioRecording, int>>> const& example_sets)
-  : pupa_(std::make_unique<TrainParams>(o1_on_thresh, o1_off_thresh, o6_limit, scale)),
-    score_computer_(std::make_unique<std::thread>(runComputeScore, pupa_.get(),
-                                                  example_sets)) {}
-  TrainParams awaitHatch()
-  {
-    PRINTF("."); fflush(stdout);
-    score_computer_->join();
-    return *pupa_;
-  }
-
-private:
-  std::unique_ptr<TrainParams> pupa_;
-  std::unique_ptr<std::thread> score_computer_;
-};
-
 class TrainParamsFactory
 {
 public:
   TrainParamsFactory(std::vector<std::pair<AudioRecording, int>> const& raw_examples,
                      double scale, bool mic_near_mouth);
 
-  bool emplaceIfValid(std::vector<TrainParamsCocoon>& ret, double o1_on_thresh,
+  bool emplaceIfValid(std::vector<TrainParams>& ret, double o1_on_thresh,
                       double o1_off_thresh, double o6_limit)
   {
     if (o1_off_thresh < o1_on_thresh)
     {
-      ret.emplace_back(o1_on_thresh, o1_off_thresh, o6_limit,
-                       scale_, examples_sets_);
+      ret.emplace_back(o1_on_thresh, o1_off_thresh, o6_limit, scale_);
       return true;
     }
     return false;
   }
 
-  void emplaceRandomParams(std::vector<TrainParamsCocoon>& ret)
+  void emplaceRandomParams(std::vector<TrainParams>& ret)
   {
     while (true)
     {
@@ -213,9 +166,9 @@ public:
 
 #define HIDEOUS_FOR(x, mn, mx) for (double x = mn + 0.25*( mx - mn ); x <= mn + 0.75*( mx - mn ); x += 0.5*( mx - mn ))
 
-  std::vector<TrainParamsCocoon> startingSet()
+  std::vector<TrainParams> startingSet()
   {
-    std::vector<TrainParamsCocoon> ret;
+    std::vector<TrainParams> ret;
     HIDEOUS_FOR(o1_on_thresh, kMinO1On, kMaxO1On)
     HIDEOUS_FOR(o1_off_thresh, kMinO1Off, kMaxO1Off)
     HIDEOUS_FOR(o6_limit, kMinO6Limit, kMaxO6Limit)
@@ -226,7 +179,7 @@ public:
     ret.emplace_back(0.5*(kMaxO1On-kMinO1On),
                      0.5*(kMaxO1Off-kMinO1Off),
                      0.5*(kMaxO6Limit-kMinO6Limit),
-                     scale_, examples_sets_);
+                     scale_);
     for (int i = 0; i < 20; i++)
       emplaceRandomParams(ret);
     return ret;
@@ -234,9 +187,9 @@ public:
 
 #define KEEP_IN_BOUNDS(mn,x,mx) do { x = std::min(x, mx); x = std::max(x, mn); } while(false)
 
-  std::vector<TrainParamsCocoon> patternAround(TrainParams x)
+  std::vector<TrainParams> patternAround(TrainParams x)
   {
-    std::vector<TrainParamsCocoon> ret;
+    std::vector<TrainParams> ret;
 
     double left_o1_on_thresh = x.o1_on_thresh - (kMaxO1On-kMinO1On)/pattern_divisor_;
     KEEP_IN_BOUNDS(kMinO1On, left_o1_on_thresh, kMaxO1On);
@@ -278,9 +231,8 @@ public:
 
   void shrinkSteps() { pattern_divisor_ *= 2.0; }
 
-  // A vector of example-sets. Each example-set is a vector of samples of audio,
-  // paired with how many events are expected to be in that audio.
-  std::vector<std::vector<std::pair<AudioRecording, int>>> examples_sets_;
+  std::shared_ptr<const TrainingCorpus> corpus_;
+  ScoreMemo score_memo_;
 private:
   // The factor that all Fourier power outputs will be multiplied by.
   const double scale_;
@@ -294,10 +246,8 @@ private:
 TrainParamsFactory::TrainParamsFactory(
     std::vector<std::pair<AudioRecording, int>> const& raw_examples,
     double scale, bool mic_near_mouth)
-  : scale_(scale)
-{
-  TrainParamsFactoryCtorCommon(&examples_sets_, raw_examples, scale, mic_near_mouth);
-}
+  : corpus_(makeTrainingCorpus(raw_examples, scale, mic_near_mouth)),
+    scale_(scale) {}
 
 } // namespace
 
@@ -310,25 +260,10 @@ double pickHumScalingFactor(std::vector<std::pair<AudioRecording, int>>
       most_examples_ind = i;
   AudioRecording const& rec = audio_examples[most_examples_ind].first;
 
-  FourierLease lease = g_fourier->borrowWorker();
-
+  Spectrogram spectra(rec.samples(), rec.numChannels(), 1.0);
   std::vector<double> o1;
-  std::vector<float> const& samples = rec.samples();
-  for (int i = 0;
-       i + kFourierBlocksize*g_num_channels < samples.size();
-       i += kFourierBlocksize * g_num_channels)
-  {
-    for (int j=0; j<kFourierBlocksize; j++)
-    {
-      if (g_num_channels == 2)
-        lease.in[j] = (samples[i + j*g_num_channels] + samples[i + j*g_num_channels + 1]) / 2.0;
-      else
-        lease.in[j] = samples[i + j];
-    }
-    lease.runFFT();
-
-    o1.push_back(lease.out[1][0]*lease.out[1][0] + lease.out[1][1]*lease.out[1][1]);
-  }
+  for (int i = 0; i < spectra.numBlocks(); i++)
+    o1.push_back(spectra.block(i).octave[kHumLowOctave]);
 
   std::sort(o1.begin(), o1.end());
 
@@ -0,0 +1,80 @@
+#include "training_corpus.h"
+
+TrainingCorpus::TrainingCorpus(std::vector<ExampleSet>&& sets)
+  : sets_(std::move(sets)) {}
+
+int TrainingCorpus::numSets() const { return sets_.size(); }
+
+TrainingCorpus::ExampleSet const& TrainingCorpus::set(int index) const
+{
+  return sets_[index];
+}
+
+std::vector<TrainingCorpus::ExampleSet> const& TrainingCorpus::sets() const
+{
+  return sets_;
+}
+
+namespace {
+
+TrainingCorpus::ExampleSet spectrogramsOf(
+    std::vector<std::pair<ComplexSpectrogram, int>> const& examples,
+    double scale, double gain, ComplexSpectrogram const* noise = nullptr)
+{
+  TrainingCorpus::ExampleSet ret;
+  for (auto const& x : examples)
+    ret.emplace_back(Spectrogram(x.first, scale, gain, noise), x.second);
+  return ret;
+}
+
+} // namespace
+
+std::shared_ptr<const TrainingCorpus> makeTrainingCorpus(
+    std::vector<std::pair<AudioRecording, int>> const& raw_examples,
+    double scale, bool mic_near_mouth)
+{
+  // Every set is derived from the spectra of the base examples and noises,
+  // each FFT'd just once here; see ComplexSpectrogram.
+  std::vector<std::pair<ComplexSpectrogram, int>> base_examples;
+  for (auto const& x : raw_examples)
+    base_examples.emplace_back(
+        ComplexSpectrogram(x.first.samples(), x.first.numChannels()), x.second);
+  // If we're training for mic-near-mouth, the base examples should include a
+  // recording of light (but near the mic) mouth breathing.
+  if (mic_near_mouth)
+  {
+    AudioRecording breath = bundledRecording("data/breath.pcm");
+    breath.scale(1.0 / scale);
+    base_examples.emplace_back(
+        ComplexSpectrogram(breath.samples(), breath.numChannels()), 0);
+  }
+
+  // A noise's last audio can still be inside the blocks (in a longer example)
+  // that end up to a block's length after it.
+  const int noise_trailing_blocks = g_fourier_blocksize / g_fourier_hop;
+  std::vector<ComplexSpectrogram> noises;
+  for (const char* path : {"data/noise1.pcm", "data/noise2.pcm", "data/noise3.pcm"})
+  {
+    AudioRecording noise = bundledRecording(path);
+    noise.scale(1.0 / scale);
+    noises.emplace_back(noise.samples(), noise.numChannels(),
+                        noise_trailing_blocks);
+  }
+
+  std::vector<TrainingCorpus::ExampleSet> sets;
+  // First, add the base examples, without any noise.
+  sets.push_back(spectrogramsOf(base_examples, scale, 1.0));
+
+  // A loud version of the base examples, to make one type less likely to cause
+  // false positives for another.
+  sets.push_back(spectrogramsOf(base_examples, scale, 1.25));
+
+  // For each noise sample, our raw examples plus that noise.
+  for (auto const& noise : noises)
+    sets.push_back(spectrogramsOf(base_examples, scale, 1.0, &noise));
+
+  // Finally, a quiet version, for a challenge/tie breaker.
+  sets.push_back(spectrogramsOf(base_examples, scale, 0.75));
+
+  return std::make_shared<const TrainingCorpus>(std::move(sets));
+}
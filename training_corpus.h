@@ -0,0 +1,44 @@
+#ifndef CLICKITONGUE_TRAINING_CORPUS_H_
+#define CLICKITONGUE_TRAINING_CORPUS_H_
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "audio_recording.h"
+#include "spectrogram.h"
+
+// Everything a training run scores candidates against: a vector of
+// example-sets. Each example-set is a vector of spectrograms of audio, paired
+// with how many events are expected to be in that audio.
+//
+// Immutable once built, and handed around as a shared_ptr<const>, so any
+// number of concurrent scoring tasks can read it without copying it.
+class TrainingCorpus
+{
+public:
+  using ExampleSet = std::vector<std::pair<Spectrogram, int>>;
+
+  explicit TrainingCorpus(std::vector<ExampleSet>&& sets);
+
+  int numSets() const;
+  ExampleSet const& set(int index) const;
+  std::vector<ExampleSet> const& sets() const;
+
+private:
+  const std::vector<ExampleSet> sets_;
+};
+
+// raw_examples: the recordings, and how many events each should have.
+// scale: the factor that all Fourier power outputs will be multiplied by.
+// mic_near_mouth: whether to include a near-mic breathing recording as a
+//                 negative example.
+//
+// Besides the raw examples themselves, the corpus holds louder, quieter, and
+// background-noise-added versions of them (derived from the raw examples'
+// spectra, not from augmented copies of their audio).
+std::shared_ptr<const TrainingCorpus> makeTrainingCorpus(
+    std::vector<std::pair<AudioRecording, int>> const& raw_examples,
+    double scale, bool mic_near_mouth);
+
+#endif // CLICKITONGUE_TRAINING_CORPUS_H_
@@ -0,0 +1,27 @@
+#include "training_seed.h"
+
+#include <mutex>
+#include <optional>
+#include <random>
+
+namespace {
+
+std::mutex g_seed_mutex;
+std::optional<std::mt19937> g_fixed_seeds; // guarded by g_seed_mutex
+
+} // namespace
+
+void setTrainingSeed(uint32_t seed)
+{
+  const std::lock_guard<std::mutex> lock(g_seed_mutex);
+  g_fixed_seeds.emplace(seed);
+}
+
+uint32_t nextTrainingSeed()
+{
+  const std::lock_guard<std::mutex> lock(g_seed_mutex);
+  if (g_fixed_seeds.has_value())
+    return (*g_fixed_seeds)();
+  static std::random_device* dev = new std::random_device;
+  return (*dev)();
+}
@@ -0,0 +1,13 @@
+#ifndef CLICKITONGUE_TRAINING_SEED_H_
+#define CLICKITONGUE_TRAINING_SEED_H_
+
+#include <cstdint>
+
+// Seeds for the random number generators behind training's search. Normally
+// these come straight from std::random_device. After setTrainingSeed(), they
+// are instead a fixed sequence derived from seed, so that a training run is
+// repeatable (e.g. for benchmarking).
+void setTrainingSeed(uint32_t seed);
+uint32_t nextTrainingSeed();
+
+#endif // CLICKITONGUE_TRAINING_SEED_H_
@@ -0,0 +1,73 @@
+#include "wakeup.h"
+
+#ifdef CLICKITONGUE_LINUX
+#include <cerrno>
+#include <cstdint>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+void crash(const char* s);
+
+#ifdef CLICKITONGUE_LINUX
+
+Wakeup::Wakeup()
+{
+  event_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (event_fd_ == -1)
+    crash("couldn't create an eventfd");
+}
+
+Wakeup::~Wakeup()
+{
+  close(event_fd_);
+}
+
+void Wakeup::wake()
+{
+  uint64_t one = 1;
+  // Only fails (EAGAIN, rather than blocking) if the counter would overflow,
+  // i.e. it's already signaled.
+  (void)!write(event_fd_, &one, sizeof(one));
+}
+
+void Wakeup::wait()
+{
+  // (The eventfd is non-blocking, so sleep in poll() until it's signaled).
+  pollfd pfd{event_fd_, POLLIN, 0};
+  while (poll(&pfd, 1, -1) == -1 && errno == EINTR) {}
+  // Resets the counter. Any failure (e.g. EAGAIN, from a spurious poll()
+  // wakeup) just makes this a spurious return, which consumers tolerate.
+  uint64_t count;
+  (void)!read(event_fd_, &count, sizeof(count));
+}
+
+#else // not linux
+
+Wakeup::Wakeup() {}
+Wakeup::~Wakeup() {}
+
+void Wakeup::wake()
+{
+  // (Both this and wait() use seq_cst, so at least one of them sees the
+  // other's store: either wait() sees pending_, or this sees waiting_).
+  pending_.store(true);
+  if (waiting_.load())
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    cv_.notify_one();
+  }
+}
+
+void Wakeup::wait()
+{
+  if (pending_.exchange(false))
+    return;
+  std::unique_lock<std::mutex> lock(mu_);
+  waiting_.store(true);
+  cv_.wait(lock, [this] { return pending_.exchange(false); });
+  waiting_.store(false);
+}
+
+#endif // CLICKITONGUE_LINUX
@@ -0,0 +1,43 @@
+#ifndef CLICKITONGUE_WAKEUP_H_
+#define CLICKITONGUE_WAKEUP_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+// Lets a real-time producer wake a consumer thread that's sleeping until there
+// is work (e.g. in an SpscRing). On Linux this is an eventfd: wake() is one
+// non-blocking write(), and a wake() that lands before the consumer starts
+// waiting is remembered by the eventfd's counter, so none are lost. Elsewhere,
+// wake() sets a pending flag, which wait() sleeps on with a condition_variable;
+// wake() only takes the lock (to notify) if the consumer is actually asleep.
+//
+// Consumers must re-check for work after every wait(), which may also return
+// spuriously.
+class Wakeup
+{
+public:
+  Wakeup();
+  ~Wakeup();
+  Wakeup(Wakeup const&) = delete;
+  Wakeup& operator=(Wakeup const&) = delete;
+
+  // Any thread.
+  void wake();
+  // The consumer thread.
+  void wait();
+
+private:
+#ifdef CLICKITONGUE_LINUX
+  int event_fd_ = -1;
+#else
+  // Set by wake(), cleared by the wait() it ends (or would have).
+  std::atomic<bool> pending_{false};
+  // Whether wait() is asleep on cv_ (or about to be). Only written under mu_.
+  std::atomic<bool> waiting_{false};
+  std::mutex mu_;
+  std::condition_variable cv_;
+#endif
+};
+
+#endif // CLICKITONGUE_WAKEUP_H_
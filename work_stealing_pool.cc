@@ -0,0 +1,91 @@
+#include "work_stealing_pool.h"
+
+WorkStealingPool::WorkStealingPool(int num_threads)
+{
+  if (num_threads < 1)
+    num_threads = 1;
+  for (int i = 0; i < num_threads; i++)
+    deques_.emplace_back(std::make_unique<TaskDeque>());
+  for (int i = 0; i < num_threads; i++)
+    threads_.emplace_back(&WorkStealingPool::workerLoop, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+  {
+    const std::lock_guard<std::mutex> lock(sleep_mutex_);
+    shutting_down_ = true;
+  }
+  wakeup_.notify_all();
+  for (auto& thread : threads_)
+    thread.join();
+}
+
+int WorkStealingPool::numThreads() const { return threads_.size(); }
+
+void WorkStealingPool::enqueue(std::function<void()> task)
+{
+  TaskDeque* dest = deques_[next_deque_++ % deques_.size()].get();
+  {
+    const std::lock_guard<std::mutex> lock(dest->mutex);
+    dest->tasks.push_back(std::move(task));
+  }
+  pending_++;
+  {
+    // Taking the lock ensures a worker that just saw pending_==0 is already
+    // waiting (and so will get this notification) rather than about to wait.
+    const std::lock_guard<std::mutex> lock(sleep_mutex_);
+  }
+  wakeup_.notify_one();
+}
+
+bool WorkStealingPool::takeTask(int my_index, std::function<void()>* task)
+{
+  {
+    TaskDeque* mine = deques_[my_index].get();
+    const std::lock_guard<std::mutex> lock(mine->mutex);
+    if (!mine->tasks.empty())
+    {
+      *task = std::move(mine->tasks.back());
+      mine->tasks.pop_back();
+      pending_--;
+      return true;
+    }
+  }
+  for (int i = 1; i < deques_.size(); i++)
+  {
+    TaskDeque* victim = deques_[(my_index + i) % deques_.size()].get();
+    const std::lock_guard<std::mutex> lock(victim->mutex);
+    if (!victim->tasks.empty())
+    {
+      *task = std::move(victim->tasks.front());
+      victim->tasks.pop_front();
+      pending_--;
+      return true;
+    }
+  }
+  return false;
+}
+
+void WorkStealingPool::workerLoop(int my_index)
+{
+  while (true)
+  {
+    std::function<void()> task;
+    if (takeTask(my_index, &task))
+    {
+      task();
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    wakeup_.wait(lock, [this] { return pending_.load() > 0 || shutting_down_; });
+    if (shutting_down_ && pending_.load() == 0)
+      return;
+  }
+}
+
+WorkStealingPool* trainingPool()
+{
+  static WorkStealingPool* pool = new WorkStealingPool(std::thread::hardware_concurrency());
+  return pool;
+}
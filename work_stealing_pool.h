@@ -0,0 +1,63 @@
+#ifndef CLICKITONGUE_WORK_STEALING_POOL_H_
+#define CLICKITONGUE_WORK_STEALING_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of long-lived worker threads, each with its own task deque.
+// Workers take from the back of their own deque, and when that runs dry,
+// steal from the front of the others'. submit() returns a std::future for the
+// task's result.
+class WorkStealingPool
+{
+public:
+  explicit WorkStealingPool(int num_threads);
+  ~WorkStealingPool();
+
+  template<class F>
+  std::future<decltype(std::declval<F>()())> submit(F&& func)
+  {
+    using Result = decltype(func());
+    // (std::function needs something copyable; packaged_task isn't).
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(func));
+    std::future<Result> ret = task->get_future();
+    enqueue([task]() { (*task)(); });
+    return ret;
+  }
+
+  int numThreads() const;
+
+private:
+  struct TaskDeque
+  {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  void enqueue(std::function<void()> task);
+  // Pops from our own deque if possible, else steals from someone else's.
+  bool takeTask(int my_index, std::function<void()>* task);
+  void workerLoop(int my_index);
+
+  std::vector<std::unique_ptr<TaskDeque>> deques_;
+  std::vector<std::thread> threads_;
+  std::atomic<unsigned int> next_deque_{0};
+
+  // Number of tasks sitting in any deque, not yet taken by a worker.
+  std::atomic<int> pending_{0};
+  std::mutex sleep_mutex_;
+  std::condition_variable wakeup_;
+  bool shutting_down_ = false; // guarded by sleep_mutex_
+};
+
+// Sized to the machine's cores; created on first use, and lives forever.
+WorkStealingPool* trainingPool();
+
+#endif // CLICKITONGUE_WORK_STEALING_POOL_H_